@@ -0,0 +1,268 @@
+#pragma once
+
+#include "BlipBuffer.hpp"
+
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+class Bus;
+
+constexpr double CPU_CLOCK { 1'789'773.0 }; // NTSC, Hz
+constexpr double SAMPLE_RATE { 48'000.0 };
+
+class APU
+{
+public:
+
+	APU(Bus&);
+	~APU();
+
+	////////////////////
+	// Data access
+	////////////////////
+
+	void writeRegister(uint16_t addr, uint8_t data);
+
+	// $4015
+	uint8_t readStatus(bool read_only);
+
+	////////////////////
+	// Timing
+	////////////////////
+
+	// CPU cycles run since power on. Lags the bus until something needs
+	// the APU's state: a register access, a due interrupt or a frame end.
+	uint64_t time {};
+
+	// Runs everything due up to the bus's current cycle in one batch
+	void catchUp();
+
+	////////////////////
+	// Interrupts
+	////////////////////
+
+	// Frame counter or DMC interrupt pending; catches up only once the
+	// next one is due
+	bool irq();
+
+	////////////////////
+	// Output
+	////////////////////
+
+	// Makes everything synthesized so far readable
+	void endFrame();
+
+	size_t samplesAvailable() const;
+
+	// Mono, or the left side when panned
+	size_t readSamples(float *out, size_t count);
+
+	// Both sides; mono output is copied to each
+	size_t readSamples(float *left, float *right, size_t count);
+
+	void setQuality(BlipBuffer::Quality);
+	BlipBuffer::Quality getQuality() const;
+
+	// Output samples per nominal sample, to follow the audio device's clock
+	void setRateRatio(double);
+
+	// Position of pulse 1, pulse 2, triangle, noise and DMC from -1 (left)
+	// to 1 (right); anything off centre makes the output stereo. Set
+	// before anything is synthesized.
+	void setPanning(const std::array<float, 5>& pan);
+
+	size_t channels() const;
+
+private:
+
+	////////////////////
+	// Bus
+	////////////////////
+
+	Bus *bus;
+
+	////////////////////
+	// Channels
+	////////////////////
+
+	static constexpr uint64_t NEVER { UINT64_MAX };
+
+	struct Envelope
+	{
+		bool start;
+		bool loop;
+		bool constant;
+		uint8_t volume;
+		uint8_t divider;
+		uint8_t decay;
+
+		uint8_t output() const;
+		void clock();
+	};
+
+	struct Pulse
+	{
+		bool enabled;
+		bool halt;
+		uint8_t duty;
+		uint8_t step;
+		uint16_t period;
+		uint8_t length;
+
+		bool sweep_enabled;
+		bool sweep_negate;
+		bool sweep_reload;
+		uint8_t sweep_period;
+		uint8_t sweep_shift;
+		uint8_t sweep_divider;
+
+		// Pulse 1 negates in ones' complement
+		uint8_t negate_offset;
+
+		Envelope envelope;
+
+		uint64_t next; // time of the next sequencer step
+
+		uint16_t sweepTarget() const;
+		bool muted() const;
+		uint8_t output() const;
+		void clockSweep();
+	};
+
+	struct Triangle
+	{
+		bool enabled;
+		bool control;
+		bool linear_reload;
+		uint8_t linear_load;
+		uint8_t linear;
+		uint8_t step;
+		uint16_t period;
+		uint8_t length;
+
+		uint64_t next;
+
+		uint8_t output() const;
+	};
+
+	struct Noise
+	{
+		bool enabled;
+		bool halt;
+		bool mode;
+		uint16_t period;
+		uint16_t shift;
+		uint8_t length;
+
+		Envelope envelope;
+
+		uint64_t next;
+
+		uint8_t output() const;
+	};
+
+	struct DMC
+	{
+		bool irq_enabled;
+		bool loop;
+		uint16_t period;
+
+		uint8_t level;
+
+		uint16_t sample_addr;
+		uint16_t sample_length;
+		uint16_t addr;
+		uint16_t remaining; // bytes left to fetch
+
+		uint8_t buffer;
+		bool buffer_full;
+
+		uint8_t shift;
+		uint8_t bits;
+		bool silence;
+
+		uint64_t next;
+	};
+
+	Pulse pulse_1 {};
+	Pulse pulse_2 {};
+	Triangle triangle {};
+	Noise noise {};
+	DMC dmc {};
+
+	void clockPulse(Pulse&);
+	void clockTriangle();
+	void clockNoise();
+	void clockDMC();
+	void fetchSample();
+
+	void scheduleTriangle();
+
+	////////////////////
+	// Frame counter
+	////////////////////
+
+	bool five_step {};
+	bool irq_inhibit {};
+	bool frame_irq {};
+	bool dmc_irq {};
+
+	size_t frame_step {};
+	uint64_t frame_start {}; // time the sequence last restarted
+
+	uint64_t nextFrameEvent() const;
+	void clockFrameCounter();
+
+	void quarterFrame();
+	void halfFrame();
+
+	////////////////////
+	// Events
+	////////////////////
+
+	// Runs every channel timer and frame counter step due up to target,
+	// in time order
+	void run(uint64_t target);
+
+	// Earliest time the frame counter or DMC can raise an interrupt,
+	// predicted from their state after every catch-up and register access
+	uint64_t irq_at { NEVER };
+
+	void scheduleIRQ();
+
+	////////////////////
+	// Mixer
+	////////////////////
+
+	// Nonlinear DAC levels, from the sum of the two pulses and from
+	// 3 * triangle + 2 * noise + DMC
+	std::array<float, 31> pulse_table {};
+	std::array<float, 203> tnd_table {};
+
+	float level {};
+
+	// Panned: each side mixes the channels scaled by its gains, through
+	// the DAC curves the tables sample
+	bool stereo {};
+	std::array<float, 5> gain_left {};
+	std::array<float, 5> gain_right {};
+	float level_right {};
+
+	float mix(const std::array<float, 5>& gains) const;
+
+	void updateOutput(uint64_t at);
+
+	////////////////////
+	// Output
+	////////////////////
+
+	BlipBuffer blip;
+	BlipBuffer blip_right;
+
+	// Time the blip frame in progress started
+	uint64_t blip_start {};
+
+	void endBlipFrame();
+};
\ No newline at end of file
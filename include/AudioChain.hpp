@@ -0,0 +1,94 @@
+#pragma once
+
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+// The console's analog output stage and the conversion to what the host
+// plays, run a frame's samples at a time: high-pass filters at 90 Hz and
+// 440 Hz and a low-pass at 14 kHz, as on the NES's audio out, then a
+// polyphase resampler from the synthesis rate to the output rate. The
+// filters and the resampler's dot products are vectorized.
+class AudioChain
+{
+public:
+
+	// channels: 1, or 2 for the APU's panned output
+	AudioChain(double in_rate, double out_rate, size_t channels);
+
+	// Runs count samples of each channel through the chain and returns
+	// the output, interleaved when stereo; right is ignored for mono.
+	// The result is valid until the next call.
+	const std::vector<float>& process(const float *left, const float *right, size_t count);
+
+	size_t channels {};
+
+private:
+
+	////////////////////
+	// Filters
+	////////////////////
+
+	// First-order sections, each y[n] = pole * y[n - 1] + input term
+	float hp_90 {};
+	float hp_440 {};
+	float lp_14k {};
+
+	struct Filters
+	{
+		float hp_90_x;
+		float hp_90_y;
+		float hp_440_x;
+		float hp_440_y;
+		float lp_14k_y;
+	};
+
+	void filter(float *data, size_t count, Filters&) const;
+
+	static void highPass(float *data, size_t count, float pole, float& x, float& y);
+	static void lowPass(float *data, size_t count, float pole, float& y);
+
+	// y[n] = pole * y[n - 1] + data[n] in place, four samples at a time
+	static void recurse(float *data, size_t count, float pole, float& y);
+
+	////////////////////
+	// Resampler
+	////////////////////
+
+	static constexpr size_t TAPS { 32 };
+	static constexpr size_t PHASE_BITS { 8 };
+	static constexpr size_t PHASES { 1 << PHASE_BITS };
+
+	// Equal rates pass straight through
+	bool resampling {};
+
+	// PHASES rows of TAPS weights, each summing to 1
+	std::vector<float> kernel;
+
+	// Input samples per output sample, and the next output's position
+	// in the pending input, both 32.32 fixed point
+	uint64_t step {};
+	uint64_t position {};
+
+	static float dot(const float *samples, const float *weights);
+
+	////////////////////
+	// Channels
+	////////////////////
+
+	struct Channel
+	{
+		Filters filters;
+
+		// Filtered input the resampler has not moved past, starting with
+		// the history its kernel reaches back over
+		std::vector<float> pending;
+
+		std::vector<float> output;
+	};
+
+	std::array<Channel, 2> state {};
+
+	std::vector<float> interleaved;
+};
\ No newline at end of file
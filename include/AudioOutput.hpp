@@ -0,0 +1,118 @@
+#pragma once
+
+#include "SPSCQueue.hpp"
+
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <cstddef>
+#include <SDL.h>
+
+// Plays the emulator's samples on the default audio device. The emulation
+// thread pushes every frame's samples into a lock-free ring that the SDL
+// callback drains, and the ring's fill steers the rate the samples are made
+// at, so the emulator's 48 kHz follows the device's clock without pitch
+// changes anyone can hear and the queue never drifts into a crackle.
+class AudioOutput
+{
+public:
+
+	// Needs SDL_INIT_AUDIO; when no device opens, samples are discarded.
+	// The device may pick another rate, which rate() reports; frame_period
+	// sizes the queue the device is kept fed with.
+	AudioOutput(double sample_rate, size_t channels, std::chrono::nanoseconds frame_period);
+	~AudioOutput();
+
+	bool opened() const;
+	double rate() const;
+
+	////////////////////
+	// Emulation thread
+	////////////////////
+
+	// Queues a frame's interleaved samples; what does not fit is dropped
+	void push(const float *samples, size_t count);
+
+	// Samples to make per nominal sample, refreshed by push
+	double ratio() const;
+
+	// Seconds queued ahead of the device, and the level to drain to before
+	// emulating the next frame, for FramePacer's audio sync
+	double queued() const;
+	double target() const;
+
+	////////////////////
+	// Statistics
+	////////////////////
+
+	struct AudioStats
+	{
+		size_t callbacks; // device buffers requested
+		size_t underruns; // device buffers the queue could not fill
+		size_t starved;   // sample frames held over by underruns
+		size_t overruns;  // pushes that did not fit
+		size_t dropped;   // sample frames dropped by overruns
+		double fill_ms;   // mean queue before each push
+		double max_fill_ms;
+		double min_ratio;
+		double max_ratio;
+	};
+
+	AudioStats stats() const;
+
+private:
+
+	SDL_AudioDeviceID device {};
+	double sample_rate {};
+	size_t channels {};
+
+	// Samples per device callback, as obtained
+	size_t device_samples {};
+
+	// Unpaused once the first target's worth is queued
+	bool playing {};
+
+	static void callback(void *userdata, Uint8 *stream, int length);
+
+	////////////////////
+	// Queue
+	////////////////////
+
+	// 170 ms of 48 kHz stereo, far more than the queue is ever let grow to
+	SPSCQueue<float, 16384> ring;
+
+	// Sample frames the pacer drains the queue to; the queue peaks one
+	// emulated frame and one device buffer above it, under two frames in all
+	size_t low_water {};
+
+	// Callback thread: the levels held through an underrun
+	std::array<float, 2> last {};
+
+	////////////////////
+	// Rate control
+	////////////////////
+
+	// Largest change to the rate, well under an audible pitch shift
+	static constexpr double MAX_DELTA { 0.005 };
+
+	// Fill before a push, in sample frames, that rate control steers towards
+	double fill_target {};
+
+	double rate_ratio { 1.0 };
+
+	////////////////////
+	// Statistics
+	////////////////////
+
+	std::atomic<size_t> callbacks {};
+	std::atomic<size_t> underruns {};
+	std::atomic<size_t> starved {};
+
+	size_t pushes {};
+	size_t overruns {};
+	size_t dropped {};
+	double fill_sum {};
+	size_t fill_max {};
+	double ratio_min { 1.0 };
+	double ratio_max { 1.0 };
+};
\ No newline at end of file
@@ -0,0 +1,89 @@
+#pragma once
+
+#include <condition_variable>
+#include <cstdint>
+#include <cstdio>
+#include <deque>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+// Dumps audio to disk or to another program from a background thread, so
+// headless runs keep their full speed. Samples are written as the 32-bit
+// floats the chain produced, so dumps of the same run compare byte for
+// byte. Nothing is dropped: the emulator only waits when the writer has
+// fallen a second behind, and a WAVE file is cut at its 4 GB limit.
+class AudioWriter
+{
+public:
+
+	enum class Format
+	{
+		WAV, // IEEE float WAVE
+		Raw  // interleaved little-endian float32, e.g. ffmpeg -f f32le
+	};
+
+	// path is a file or "|command" to pipe the stream into
+	AudioWriter(const std::string& path, Format, double sample_rate, size_t channels);
+	~AudioWriter();
+
+	// Queues interleaved samples
+	void submit(const float *samples, size_t count);
+
+	// Writes everything queued and closes the output; called on destruction
+	void finish();
+
+	////////////////////
+	// Statistics
+	////////////////////
+
+	struct WriterStats
+	{
+		size_t samples; // samples written, all channels
+		size_t bytes;   // bytes written, header included
+		size_t stalls;  // submits that waited for the writer
+		size_t dropped; // samples past the WAVE size limit, never written
+	};
+
+	WriterStats stats();
+
+private:
+
+	Format format;
+	uint32_t sample_rate {};
+	uint16_t channels {};
+
+	FILE *stream {};
+	bool piped {};
+
+	// RIFF, fmt with its extension size, fact and data chunk headers
+	static constexpr uint32_t HEADER_SIZE { 58 };
+
+	// RIFF sizes are 32-bit, so a WAVE file holds this much data at most,
+	// in whole sample frames; the writer stops there
+	uint32_t max_data_bytes {};
+
+	// data_bytes is unknown until the end; pipes are sent the largest size
+	void writeHeader(uint32_t data_bytes);
+
+	////////////////////
+	// Queue
+	////////////////////
+
+	// Blocks of about a frame each, a second's worth at most
+	static constexpr size_t MAX_BLOCKS { 64 };
+
+	std::deque<std::vector<float>> blocks;
+
+	std::mutex mutex;
+	std::condition_variable queued;
+	std::condition_variable written;
+	bool stopping {};
+
+	WriterStats writer_stats {};
+
+	std::thread writer;
+
+	void write();
+};
\ No newline at end of file
@@ -0,0 +1,81 @@
+#pragma once
+
+#include "PPU.hpp"
+
+#include <array>
+#include <condition_variable>
+#include <cstdint>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+// Draws whole frames on worker threads, one horizontal band per worker.
+// The PPU records the memory it renders from at the start of a frame, every
+// write made to it while the frame is drawn and the register state of each
+// line; each band replays the log up to its lines and draws them in parallel.
+class BandRenderer
+{
+public:
+
+	BandRenderer();
+	~BandRenderer();
+
+	////////////////////
+	// Frames
+	////////////////////
+
+	struct Memory
+	{
+		std::array<PPU::Nametable, 4> nametables;
+		std::array<size_t, 4> nametable_map;
+		std::array<uint8_t, 0x2000> patterns;
+		std::array<uint8_t, 32> palettes;
+		std::array<uint8_t, 256> OAM;
+	};
+
+	struct Frame
+	{
+		Memory start;
+		std::vector<PPU::Write> writes;
+		std::array<PPU::LineState, SCREEN_H> lines;
+	};
+
+	// Frame the PPU is currently recording into
+	Frame& recording();
+
+	// Hands the recorded frame to the workers and starts recording the other
+	void submit();
+
+	// Waits for the submitted frame and copies it out, false if none was
+	bool collect(uint8_t out[SCREEN_H][SCREEN_W], std::array<uint8_t, SCREEN_H>& emphasis);
+
+private:
+
+	std::array<Frame, 2> frames {};
+	size_t recording_index {};
+	size_t rendering_index {};
+	bool pending {};
+
+	uint8_t output[SCREEN_H][SCREEN_W] {};
+	std::array<uint8_t, SCREEN_H> output_emphasis {};
+
+	////////////////////
+	// Workers
+	////////////////////
+
+	size_t band_count {};
+	std::vector<std::thread> workers;
+
+	std::mutex mutex;
+	std::condition_variable work_ready;
+	std::condition_variable work_done;
+
+	size_t job {};
+	size_t remaining {};
+	bool stopping {};
+
+	void work(size_t band);
+	void renderBand(const Frame&, size_t first, size_t last);
+
+	static void applyWrite(Memory&, const PPU::Write&);
+};
\ No newline at end of file
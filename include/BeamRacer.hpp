@@ -0,0 +1,60 @@
+#pragma once
+
+#include "FramePacer.hpp"
+#include "ScanoutClock.hpp"
+
+#include <chrono>
+#include <cstddef>
+
+// Presents each frame in horizontal slices as the PPU finishes them, each
+// just before the host display's raster reaches the rows it covers, so a
+// slice is on screen within the refresh it was emulated for instead of a
+// frame later. A frame goes to the first refresh whose raster can still be
+// beaten to its top slice; presents do not wait for vsync, and landing
+// each slice ahead of the raster is what keeps the tear off screen.
+class BeamRacer
+{
+public:
+
+	BeamRacer(FramePacer&, const ScanoutClock&, size_t slices = 4);
+
+	size_t slices;
+
+	// Pacer just released the frame
+	void beginFrame();
+
+	// Called after every CPU step; true once rows_ready completes the next
+	// slice, after sleeping until just before the raster reaches its rows.
+	// Always false when the display's timing could not be measured
+	bool sliceReady(size_t rows_ready);
+
+	// Rows covered by the slices completed so far
+	size_t rows {};
+
+	////////////////////
+	// Statistics
+	////////////////////
+
+	struct RaceStats
+	{
+		size_t frames; // frames presented in slices
+		size_t slices; // slices presented
+		size_t late;   // slices finished after the raster reached them
+	};
+
+	RaceStats race_stats {};
+
+private:
+
+	FramePacer *pacer;
+	const ScanoutClock *scanout;
+
+	size_t next_slice {};
+
+	// When the raster reaches the top of the slice last presented
+	std::chrono::steady_clock::time_point raster {};
+
+	// Time for a released slice to reach the screen: the hand-over to the
+	// SDL thread, uploading its rows and presenting
+	static constexpr std::chrono::nanoseconds LEAD { std::chrono::microseconds { 1500 } };
+};
\ No newline at end of file
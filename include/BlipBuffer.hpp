@@ -0,0 +1,90 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+// Band-limited step synthesis. Sources report only when their amplitude
+// changes, stamped in source clocks; each change is added to the output as
+// a windowed-sinc step at its exact sub-sample position, so producing
+// output costs a running sum per sample instead of anything per clock.
+class BlipBuffer
+{
+public:
+
+	// Taps of the step kernel
+	enum class Quality
+	{
+		Low,    // 8
+		Medium, // 16
+		High    // 32
+	};
+
+	// capacity: output samples kept before the oldest are discarded
+	BlipBuffer(double clock_rate, double sample_rate, size_t capacity);
+
+	static Quality next(Quality);
+	static const char *name(Quality);
+
+	void setQuality(Quality);
+	Quality getQuality() const;
+
+	// Scales the output rate, so a consumer whose clock runs slightly off
+	// the nominal sample rate is fed exactly what it plays
+	void setRatio(double ratio);
+
+	////////////////////
+	// Input
+	////////////////////
+
+	// Adds an amplitude change at a time within the current frame
+	void addDelta(uint64_t time, float delta);
+
+	// Ends the current frame after time clocks; its samples become readable
+	void endFrame(uint64_t time);
+
+	////////////////////
+	// Output
+	////////////////////
+
+	size_t available() const;
+
+	// Reads up to count samples, or discards them when out is nullptr
+	size_t read(float *out, size_t count);
+
+	size_t discarded {}; // samples dropped because nobody read them
+
+private:
+
+	static constexpr size_t MAX_TAPS { 32 };
+	static constexpr size_t PHASE_BITS { 6 };
+	static constexpr size_t PHASES { 1 << PHASE_BITS };
+
+	Quality quality { Quality::Medium };
+	size_t taps {};
+
+	// PHASES rows of taps weights, each summing to 1
+	std::vector<float> kernel;
+
+	void buildKernel();
+
+	////////////////////
+	// Buffer
+	////////////////////
+
+	// Output samples per clock at a ratio of 1
+	double nominal {};
+
+	// Output samples per clock and output position of the frame start,
+	// both 32.32 fixed point
+	uint64_t factor {};
+	uint64_t offset {};
+
+	size_t capacity {};
+
+	// Accumulated deltas; the first samples entries are complete
+	std::vector<float> buffer;
+	size_t samples {};
+
+	float integrator {};
+};
\ No newline at end of file
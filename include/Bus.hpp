@@ -1,6 +1,8 @@
 #pragma once
 
+#include "APU.hpp"
 #include "Cartridge.hpp"
+#include "Controller.hpp"
 #include "CPU.hpp"
 #include "PPU.hpp"
 
@@ -19,7 +21,9 @@ public:
 	////////////////////
 
 	CPU *cpu;
+	APU *apu {};
 
+	void connectAPU(APU&);
 	void connectCartridge(Cartridge&);
 	void connectCPU(CPU&);
 	void connectPPU(PPU&);
@@ -28,15 +32,18 @@ public:
 	// Timing
 	////////////////////
 
-	uint32_t cpu_cycles {};
+	uint64_t cpu_cycles {};
 
-	void tick(uint8_t cycles);
+	void tick(uint16_t cycles);
+
+	// Level of the IRQ line, shared by every source
+	bool irq() const;
 
 	////////////////////
 	// Data access
 	////////////////////
 
-	uint8_t cpuRead(uint16_t addr) const;
+	uint8_t cpuRead(uint16_t addr);
 	void cpuWrite(uint16_t addr, uint8_t data);
 
 	uint8_t ppuRead(uint16_t addr) const;
@@ -48,6 +55,13 @@ public:
 
 	Cartridge *cartridge;
 
+	////////////////////
+	// Input
+	////////////////////
+
+	// $4016 and $4017
+	std::array<Controller, 2> controllers {};
+
 private:
 
 	////////////////////
@@ -56,11 +70,15 @@ private:
 
 	std::array<uint8_t, 2048> RAM {};
 
+	const uint8_t *cpuPage(uint8_t page) const;
+
 	////////////////////
 	// PPU
 	////////////////////
 
 	PPU *ppu;
 
+	void oamDMA(uint8_t page);
+
 	std::array<uint8_t, 2048> VRAM {};
 };
\ No newline at end of file
@@ -44,6 +44,9 @@ public:
 	uint8_t read(uint16_t addr) const;
 	void write(uint16_t addr, uint8_t data);
 
+	// Both stores of a read-modify-write instruction
+	void modify(uint16_t addr, uint8_t data, uint8_t result);
+
 	////////////////////
 	// Registers
 	////////////////////
@@ -0,0 +1,137 @@
+#pragma once
+
+#include "PPU.hpp"
+
+#include <array>
+#include <chrono>
+#include <condition_variable>
+#include <cstdint>
+#include <cstdio>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+// Records frames to disk or to another program without holding up the
+// emulator. Frames are copied into a fixed ring of slots, encoded on a pool
+// of workers and written strictly in order by a writer thread. When every
+// slot is still in use, real-time runs drop and count the frame, while runs
+// without a deadline wait so the recording keeps every frame.
+class Capture
+{
+public:
+
+	enum class Format
+	{
+		Y4M, // YUV 4:4:4 stream, readable by ffmpeg and most players
+		Raw, // packed RGB24 frames, e.g. for ffmpeg -f rawvideo
+		PNG  // one numbered image per frame
+	};
+
+	// What submit does when every slot is still in use
+	enum class Overflow
+	{
+		Drop, // count the frame and return, for runs paced in real time
+		Wait  // block until the writer frees a slot, nothing is lost
+	};
+
+	// path is a file, "|command" to pipe the stream into, or for PNG the
+	// prefix of the numbered files; frame_period sets the Y4M frame rate.
+	// colors: ARGB indexed by (emphasis << 6) | color
+	Capture(
+		const std::string& path,
+		Format,
+		const uint32_t *colors,
+		std::chrono::nanoseconds frame_period,
+		Overflow = Overflow::Drop
+	);
+
+	~Capture();
+
+	// Queues a frame, false if it was dropped
+	bool submit(const uint8_t pixels[SCREEN_H][SCREEN_W], const std::array<uint8_t, SCREEN_H>& emphasis);
+
+	// Writes every queued frame and closes the output; called on destruction
+	void finish();
+
+	////////////////////
+	// Statistics
+	////////////////////
+
+	struct CaptureStats
+	{
+		size_t frames;    // frames written
+		size_t dropped;   // frames submitted while every slot was in use
+		size_t stalls;    // submits that waited for a free slot
+		size_t bytes;     // bytes written
+		double encode_us; // encoding, all frames
+	};
+
+	CaptureStats stats();
+
+private:
+
+	std::string path;
+	Format format;
+	const uint32_t *colors;
+	Overflow overflow;
+
+	FILE *stream {};
+	bool piped {};
+
+	////////////////////
+	// Slots
+	////////////////////
+
+	enum class State
+	{
+		Free,
+		Queued,
+		Encoding,
+		Encoded
+	};
+
+	struct Slot
+	{
+		uint8_t pixels[SCREEN_H][SCREEN_W];
+		std::array<uint8_t, SCREEN_H> emphasis;
+		size_t number;
+		std::vector<uint8_t> encoded;
+		State state;
+	};
+
+	static constexpr size_t SLOTS { 16 };
+
+	std::array<Slot, SLOTS> slots {};
+
+	// Frames are numbered as submitted; slot number % SLOTS holds each
+	size_t next_submit {};
+	size_t next_encode {};
+	size_t next_write {};
+
+	std::mutex mutex;
+	std::condition_variable work_ready;
+	std::condition_variable encoded;
+	std::condition_variable freed;
+	bool stopping {};
+
+	CaptureStats capture_stats {};
+
+	std::vector<std::thread> encoders;
+	std::thread writer;
+
+	void encode();
+	void write();
+
+	////////////////////
+	// Formats
+	////////////////////
+
+	void resolve(const Slot&, size_t Y, uint8_t *rgb) const;
+
+	void encodeY4M(const Slot&, std::vector<uint8_t>& out) const;
+	void encodeRaw(const Slot&, std::vector<uint8_t>& out) const;
+	void encodePNG(const Slot&, std::vector<uint8_t>& out) const;
+
+	static void appendChunk(std::vector<uint8_t>& out, const char *type, const uint8_t *data, size_t size);
+};
\ No newline at end of file
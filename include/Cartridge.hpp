@@ -2,12 +2,19 @@
 
 #include "Mapper.hpp"
 #include "Mapper000.hpp"
+#include "Mapper001.hpp"
+#include "Mapper002.hpp"
+#include "Mapper003.hpp"
+#include "Mapper004.hpp"
+#include "Mapper007.hpp"
+
+class PPU;
 
 #include <cstdint>
 #include <fstream>
 #include <iostream>
-#include <memory>
 #include <string>
+#include <variant>
 #include <vector>
 
 constexpr size_t PRG_BANK_SIZE = 16384; // 16 KB
@@ -25,17 +32,17 @@ struct iNESHeader
 
 	struct
 	{
-		char mirroring   : 1;
-		char battery     : 1;
-		char trainer     : 1;
-		char four_screen : 1;
-		char mapper_low  : 4;
+		uint8_t mirroring   : 1;
+		uint8_t battery     : 1;
+		uint8_t trainer     : 1;
+		uint8_t four_screen : 1;
+		uint8_t mapper_low  : 4;
 	} flags_6;
 
 	struct
 	{
-		char reserved    : 4;
-		char mapper_high : 4;
+		uint8_t reserved    : 4;
+		uint8_t mapper_high : 4;
 	} flags_7;
 
 	uint8_t prg_ram_banks;
@@ -77,12 +84,26 @@ public:
 	std::vector<uint8_t> CHR_ROM;
 	std::vector<uint8_t> PRG_ROM;
 
+	// Cartridges without CHR ROM carry 8 KB of CHR RAM instead
+	bool chr_ram {};
+
 	////////////////////
 	// Data access
 	////////////////////
 
+	// Page lookups every mapper shares, inlined into callers
 	uint8_t readPRG(uint16_t addr) const;
 	uint8_t readCHR(uint16_t addr) const;
+	void writeCHR(uint16_t addr, uint8_t data);
+
+	const uint8_t *chrPage(size_t page) const;
+
+	// $4020-$FFFF: PRG RAM and mapper registers. cycle is the CPU cycle of
+	// the instruction making the write.
+	void writePRG(uint16_t addr, uint8_t data, uint64_t cycle);
+
+	// Mappers report every 1 KB CHR page they repoint
+	void chrPageSwitched(size_t page);
 
 	////////////////////
 	// Mirroring
@@ -92,9 +113,38 @@ public:
 	{
 		Horizontal,
 		Vertical,
+		SingleScreenLow,
+		SingleScreenHigh,
 		FourScreen
 	} mirroring;
 
+	// Mappers switch mirroring at runtime through here
+	void setMirroring(Mirroring);
+
+	////////////////////
+	// IRQ
+	////////////////////
+
+	static constexpr uint64_t NO_IRQ { UINT64_MAX };
+
+	// PPU cycle from which the mapper holds the IRQ line: 0 while it does,
+	// NO_IRQ while nothing is scheduled
+	uint64_t irq_dot { NO_IRQ };
+
+	// The PPU reports register writes that move its A12 rises, and every
+	// rise on lines where only the fetches tell
+	void a12Changed();
+	void clockA12();
+
+	////////////////////
+	// PPU
+	////////////////////
+
+	// Followed by mappers that count lines
+	PPU *ppu {};
+
+	void connectPPU(PPU&);
+
 private:
 
 	////////////////////
@@ -127,5 +177,73 @@ private:
 
 	uint8_t mapper_id;
 
-	std::unique_ptr<Mapper> mapper;
-};
\ No newline at end of file
+	// Empty until a ROM with a supported mapper is loaded
+	std::variant<
+		std::monostate,
+		Mapper000,
+		Mapper001,
+		Mapper002,
+		Mapper003,
+		Mapper004,
+		Mapper007
+	> mapper;
+
+	// Page tables of the loaded mapper, read without dispatching on it
+	Mapper *banks {};
+};
+
+////////////////////
+// Data access
+////////////////////
+
+inline uint8_t Cartridge::readPRG(uint16_t addr) const
+{
+	return (banks != nullptr) ? banks->readPRG(addr) : 0;
+}
+
+inline uint8_t Cartridge::readCHR(uint16_t addr) const
+{
+	return (banks != nullptr) ? banks->readCHR(addr) : 0;
+}
+
+inline void Cartridge::writeCHR(uint16_t addr, uint8_t data)
+{
+	if (banks != nullptr)
+		banks->writeCHR(addr, data);
+}
+
+inline void Cartridge::writePRG(uint16_t addr, uint8_t data, uint64_t cycle)
+{
+	std::visit(Overloaded {
+		[](std::monostate) {},
+		[addr, data, cycle](auto& loaded) { loaded.writePRG(addr, data, cycle); }
+	}, mapper);
+}
+
+inline const uint8_t *Cartridge::chrPage(size_t page) const
+{
+	// Nothing loaded shows blank tiles
+	static constexpr uint8_t BLANK[0x0400] {};
+
+	return (banks != nullptr) ? banks->chrPage(page) : &BLANK[0];
+}
+
+////////////////////
+// IRQ
+////////////////////
+
+inline void Cartridge::a12Changed()
+{
+	std::visit(Overloaded {
+		[](std::monostate) {},
+		[](auto& loaded) { loaded.a12Changed(); }
+	}, mapper);
+}
+
+inline void Cartridge::clockA12()
+{
+	std::visit(Overloaded {
+		[](std::monostate) {},
+		[](auto& loaded) { loaded.clockA12(); }
+	}, mapper);
+}
\ No newline at end of file
@@ -0,0 +1,49 @@
+#pragma once
+
+#include <atomic>
+#include <cstdint>
+
+// Standard controller. The CPU strobes $4016 to load the shift register
+// with the buttons, then reads them out one bit at a time. The host sets
+// held from its own thread; the emulator takes a snapshot once per frame,
+// so a read costs a shift and never touches host state.
+class Controller
+{
+public:
+
+	enum Button : uint8_t
+	{
+		A      = 1 << 0,
+		B      = 1 << 1,
+		Select = 1 << 2,
+		Start  = 1 << 3,
+		Up     = 1 << 4,
+		Down   = 1 << 5,
+		Left   = 1 << 6,
+		Right  = 1 << 7
+	};
+
+	////////////////////
+	// Host
+	////////////////////
+
+	void press(uint8_t buttons, bool pressed);
+
+	// Takes the buttons held on the host as the input for the next frame
+	void sample();
+
+	////////////////////
+	// Data access
+	////////////////////
+
+	void write(uint8_t data);
+	uint8_t read(bool read_only);
+
+private:
+
+	std::atomic<uint8_t> held {};
+
+	uint8_t buttons {};
+	uint8_t shift {};
+	bool strobe {};
+};
\ No newline at end of file
@@ -0,0 +1,60 @@
+#pragma once
+
+#include "PPU.hpp"
+
+#include <array>
+#include <atomic>
+#include <cstdint>
+#include <string>
+
+// Triple buffer handing finished frames from the emulation thread to the
+// presentation thread. Neither side ever waits: the producer always has a
+// back frame to fill and the consumer always gets the newest published one.
+class FrameExchange
+{
+public:
+
+	struct Frame
+	{
+		uint8_t pixels[SCREEN_H][SCREEN_W];
+		std::array<uint8_t, SCREEN_H> emphasis;
+		std::string overlay;
+
+		// Emulated frame this is, and how many of its rows are complete;
+		// fewer than SCREEN_H for slices of a frame still being drawn
+		size_t number;
+		size_t rows;
+	};
+
+	////////////////////
+	// Producer
+	////////////////////
+
+	Frame& back();
+
+	// Makes the back frame the newest one and takes another to fill
+	void publish();
+
+	////////////////////
+	// Consumer
+	////////////////////
+
+	// Newest frame published since the last call, nullptr if none
+	const Frame *acquire();
+
+	size_t published {};
+	size_t dropped {}; // published frames replaced before being acquired
+
+private:
+
+	std::array<Frame, 3> frames {};
+
+	size_t back_index { 0 };
+	size_t front_index { 1 };
+
+	// Index of the frame between the two threads, FRESH while it has not
+	// been acquired yet
+	static constexpr uint8_t FRESH { 0x80 };
+
+	std::atomic<uint8_t> middle { 2 };
+};
\ No newline at end of file
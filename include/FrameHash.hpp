@@ -0,0 +1,48 @@
+#pragma once
+
+#include "PPU.hpp"
+
+#include <array>
+#include <cstdint>
+#include <fstream>
+#include <string>
+#include <vector>
+
+// Fingerprints completed frames so regression runs compare 8 bytes per
+// frame instead of images. The log is a short header followed by one
+// little-endian 64-bit hash per frame.
+class FrameHash
+{
+public:
+
+	// Starts a new log at path
+	FrameHash(const std::string& path);
+
+	void record(const uint8_t buffer[SCREEN_H][SCREEN_W], const std::array<uint8_t, SCREEN_H>& emphasis);
+
+	size_t frames {};
+
+	////////////////////
+	// Hashing
+	////////////////////
+
+	// XXH64 of a block of memory
+	static uint64_t xxh64(const uint8_t *data, size_t size, uint64_t seed = 0);
+
+	// Hash of everything that decides what a frame looks like: its color
+	// indexes and the emphasis of every line
+	static uint64_t frame(const uint8_t buffer[SCREEN_H][SCREEN_W], const std::array<uint8_t, SCREEN_H>& emphasis);
+
+	////////////////////
+	// Logs
+	////////////////////
+
+	// Hashes of every frame in a log, empty if it cannot be read
+	static std::vector<uint64_t> load(const std::string& path);
+
+private:
+
+	static constexpr char MAGIC[8] { 'B', 'N', 'E', 'S', 'H', 'A', 'S', 'H' };
+
+	std::ofstream log;
+};
\ No newline at end of file
@@ -0,0 +1,99 @@
+#pragma once
+
+#include <chrono>
+#include <cstddef>
+#include <functional>
+
+constexpr std::chrono::nanoseconds NTSC_FRAME { 16'639'267 }; // 1 / 60.0988 Hz
+constexpr std::chrono::nanoseconds PAL_FRAME { 19'997'200 };  // 1 / 50.0070 Hz
+
+// Holds the emulation to the console's frame rate. Sleeps until shortly
+// before a frame is due and spins the rest, so the host core idles between
+// frames without waking late. The display never paces emulation: with vsync
+// on, presentation alone waits for it and the pacer keeps its own clock.
+class FramePacer
+{
+public:
+
+	enum class Region
+	{
+		NTSC,
+		PAL
+	};
+
+	enum class Sync
+	{
+		Timer, // sleep, then spin to the deadline
+		Audio  // wait while the audio queue is above its target
+	};
+
+	FramePacer(Region = Region::NTSC, Sync = Sync::Timer);
+
+	Region region;
+	Sync sync;
+
+	std::chrono::nanoseconds period() const;
+
+	// Audio sync: seconds of audio still queued for the device
+	std::function<double()> audio_queued;
+	double audio_target { 0.050 };
+
+	// Blocks until the next frame is due at `speed` times real time
+	void wait(size_t speed = 1);
+
+	// Forget the deadline, e.g. after a change of speed
+	void reset();
+
+	// Sleeps, then spins, until the given time
+	void waitUntil(std::chrono::steady_clock::time_point until);
+
+	////////////////////
+	// Statistics
+	////////////////////
+
+	// Deviation of each frame's length from the period it was paced to
+	struct JitterStats
+	{
+		size_t frames; // frames paced
+		size_t late;   // frames already overdue when wait() was called
+		double mean_us;
+		double rms_us;
+		double max_us;
+	};
+
+	JitterStats jitter() const;
+
+private:
+
+	using Clock = std::chrono::steady_clock;
+
+	Clock::time_point deadline {};
+	Clock::time_point last_frame {};
+
+	// How early the sleep ends before a deadline, tuned to the oversleep the
+	// host's timer actually shows
+	std::chrono::nanoseconds spin_margin { std::chrono::milliseconds { 1 } };
+
+	static constexpr std::chrono::nanoseconds MIN_MARGIN { std::chrono::microseconds { 200 } };
+	static constexpr std::chrono::nanoseconds MAX_MARGIN { std::chrono::milliseconds { 2 } };
+
+	// A host this many frames behind stops trying to catch up
+	static constexpr size_t MAX_LAG { 4 };
+
+	void sleepUntil(Clock::time_point);
+	void waitTimer(std::chrono::nanoseconds frame);
+	void waitAudio(std::chrono::nanoseconds frame);
+
+	////////////////////
+	// Statistics
+	////////////////////
+
+	size_t frames {};
+	size_t late {};
+	size_t measured {}; // frames with a previous one to measure against
+	double jitter_sum {};
+	double jitter_squares {};
+	double jitter_max {};
+
+	void record(std::chrono::nanoseconds frame);
+};
\ No newline at end of file
@@ -0,0 +1,54 @@
+#pragma once
+
+#include "FramePacer.hpp"
+
+#include <chrono>
+#include <cstddef>
+
+// Decides which frames the PPU leaves undrawn
+class FrameSkip
+{
+public:
+
+	enum class Mode
+	{
+		Off,
+		Fixed,    // skip `frames` frames after every drawn one
+		Adaptive, // skip while the host is behind real time
+		Throttled // draw at most one frame per frame period of host time
+	};
+
+	// period is the length of an emulated frame, as the pacer waits it
+	FrameSkip(
+		Mode = Mode::Off,
+		size_t frames = 0,
+		std::chrono::nanoseconds period = NTSC_FRAME
+	);
+
+	void setMode(Mode, size_t frames = 0);
+
+	Mode getMode() const;
+	size_t getFrames() const;
+
+	// Called once per completed frame, true when the next should be skipped
+	bool next();
+
+private:
+
+	Mode mode;
+	size_t frames;
+
+	std::chrono::nanoseconds period;
+
+	// Fixed
+	size_t counter {};
+
+	// Adaptive: where the emulated frames should be in host time
+	// Throttled: when the next frame may be drawn
+	std::chrono::steady_clock::time_point deadline {};
+	size_t run {};
+
+	// Adaptive skips stop after this many frames in a row so the screen
+	// never freezes, and a host further behind than this gives up catching up
+	static constexpr size_t MAX_SKIP { 8 };
+};
\ No newline at end of file
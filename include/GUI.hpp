@@ -1,27 +1,103 @@
 #pragma once
 
+#include "ScanoutClock.hpp"
+
 #include <array>
 #include <iostream>
+#include <string>
 #include <SDL.h>
 
 constexpr size_t WIDTH { 256 };
 constexpr size_t HEIGHT { 240 };
 constexpr size_t SCALE { 3 };
 
+// Key press or release, handed from the SDL thread to the emulation thread
+struct KeyEvent
+{
+	SDL_Keycode key;
+	bool pressed;
+};
+
 class GUI
 {
 public:
 
-	GUI();
+	// With a scanout clock, the display's refresh is measured through a
+	// run of vsynced presents before the renderer is set up
+	GUI(bool vsync = false, ScanoutClock *scanout = nullptr);
 	~GUI();
 
-	void renderFrame(uint32_t buffer[HEIGHT][WIDTH]);
+	// Tells the scanout clock where the window now is; call on window
+	// events
+	void trackWindow();
+
+	// Converts rows [first, last) of an indexed frame to ARGB through
+	// colors, indexed by (emphasis << 6) | color, and presents them over
+	// what the texture already holds
+	void renderFrame(
+		const uint8_t buffer[HEIGHT][WIDTH],
+		const uint8_t *emphasis,
+		const uint32_t *colors,
+		size_t first = 0,
+		size_t last = HEIGHT
+	);
+
+	// Presents an ARGB image of any size, e.g. a filtered frame
+	void renderImage(const uint32_t *pixels, size_t width, size_t height);
+
+	// One row of color indexes to ARGB
+	static void convertRow(const uint8_t *indexes, const uint32_t *colors, uint32_t *out);
 
 	SDL_Event event;
 
+	// Drawn in the top-left corner of every presented frame
+	std::string overlay;
+
+	////////////////////
+	// Statistics
+	////////////////////
+
+	// false when SDL fell back to the software renderer
+	bool accelerated {};
+
+	struct PresentStats
+	{
+		size_t frames;     // frames presented
+		double convert_us; // writing pixels into the locked texture
+		double present_us; // copying the texture and presenting it
+		double max_us;     // slowest frame, both stages
+	};
+
+	PresentStats present_stats {};
+
 private:
 
 	SDL_Window *window { nullptr };
 	SDL_Renderer *renderer { nullptr };
 	SDL_Texture *texture { nullptr };
+
+	// Sized to the last image presented
+	SDL_Texture *image_texture { nullptr };
+	size_t image_W {};
+	size_t image_H {};
+
+	void present(SDL_Texture *, Uint64 start, Uint64 converted);
+
+	////////////////////
+	// Scanout
+	////////////////////
+
+	ScanoutClock *scanout;
+
+	// About two seconds of refreshes; the longer the run, the less the
+	// fitted period errs and the slower the modelled raster drifts
+	static constexpr size_t CALIBRATION_PRESENTS { 120 };
+
+	void calibrateScanout();
+
+	// Refresh period of the window's display, zero if unknown
+	std::chrono::nanoseconds displayPeriod() const;
+
+	// stride is the texture pitch in pixels
+	void drawOverlay(uint32_t *pixels, size_t stride) const;
 };
\ No newline at end of file
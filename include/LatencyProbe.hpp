@@ -0,0 +1,49 @@
+#pragma once
+
+#include "PPU.hpp"
+
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+
+// Measures input latency through the emulator: from a key press on the
+// host to the first emulated frame that looks different from the frame
+// completed when the press was sampled. Display latency is not included.
+class LatencyProbe
+{
+public:
+
+	// Input thread: timestamps a key press, ignored while one is measured
+	void press();
+
+	// Emulation thread: every completed frame, after input is sampled
+	void frame(const uint8_t buffer[SCREEN_H][SCREEN_W], const std::array<uint8_t, SCREEN_H>& emphasis);
+
+	////////////////////
+	// Statistics
+	////////////////////
+
+	struct LatencyStats
+	{
+		size_t presses;  // presses that changed the picture
+		size_t ignored;  // presses with no visible effect within TIMEOUT frames
+		double frames;   // emulated frames until the change, all presses
+		double ms;       // host time until the change, all presses
+		double max_ms;
+	};
+
+	// Read once the emulation thread has stopped
+	LatencyStats latency_stats {};
+
+private:
+
+	static constexpr size_t TIMEOUT { 120 };
+
+	// Host time of the press being measured, 0 while idle
+	std::atomic<int64_t> pressed_at {};
+
+	bool measuring {};
+	uint64_t baseline {};
+	size_t frames {};
+};
\ No newline at end of file
@@ -1,11 +1,43 @@
 #pragma once
 
+#include <array>
+#include <cstddef>
+#include <cstdint>
 #include <iostream>
+#include <vector>
 
 class Cartridge;
 
+// State every mapper shares. Mappers have no virtual functions: Cartridge
+// holds the concrete one in a std::variant picked by loadROM, and each
+// mapper defines writePRG, so a write compiles to a switch on the loaded
+// type and the mapper's own decoding.
+//
+// Reads never look at mapper registers. Bank switches repoint the CPU's
+// 8 KB PRG pages and the PPU's 1 KB CHR pages when they are written, so
+// every read is the same page lookup and needs no dispatch at all.
 class Mapper
 {
+public:
+
+	////////////////////
+	// Data access
+	////////////////////
+
+	uint8_t readPRG(uint16_t addr) const;
+	uint8_t readCHR(uint16_t addr) const;
+	void writeCHR(uint16_t addr, uint8_t data);
+
+	const uint8_t *chrPage(size_t page) const;
+
+	////////////////////
+	// A12
+	////////////////////
+
+	// Only mappers that count lines define these
+	void a12Changed() {}
+	void clockA12() {}
+
 protected:
 
 	Mapper(Cartridge *);
@@ -16,14 +48,86 @@ protected:
 
 	Cartridge *cartridge;
 
-public:
+	////////////////////
+	// Banks
+	////////////////////
 
-	virtual ~Mapper();
+	// $8000, $A000, $C000 and $E000
+	std::array<const uint8_t *, 4> prg_pages {};
+
+	// $0000-$1FFF in 1 KB steps
+	std::array<uint8_t *, 8> chr_pages {};
+
+	// CHR RAM instead of ROM
+	bool chr_writable {};
+
+	// Points the pages from slot on at a bank of the given size, counted
+	// in banks of that size and wrapped to the ROM
+	void mapPRG(size_t slot, size_t size, size_t bank);
+	void mapCHR(size_t page, size_t size, size_t bank);
+
+	// Number of banks of the given size in the ROM
+	size_t prgBanks(size_t size) const;
+	size_t chrBanks(size_t size) const;
 
 	////////////////////
-	// Data access
+	// Mirroring
 	////////////////////
 
-	virtual uint8_t readPRG(uint16_t addr) const = 0;
-	virtual uint8_t readCHR(uint16_t addr) const = 0;
-};
\ No newline at end of file
+	// Out of line, as Cartridge is incomplete here
+	void mirrorSingleScreen(bool high);
+
+	////////////////////
+	// PRG RAM
+	////////////////////
+
+	// $6000-$7FFF, empty on boards without it
+	std::vector<uint8_t> prg_ram;
+
+	void writeRAM(uint16_t addr, uint8_t data);
+};
+
+// Visitor built from one lambda per case
+template <typename... Cases>
+struct Overloaded : Cases...
+{
+	using Cases::operator()...;
+};
+
+////////////////////
+// Data access
+////////////////////
+
+inline uint8_t Mapper::readPRG(uint16_t addr) const
+{
+	if (addr >= 0x8000)
+		return prg_pages[(addr >> 13) & 0x03][addr & 0x1FFF];
+
+	// Anything below PRG RAM, or without it, is open bus
+	if (addr >= 0x6000 && prg_ram.empty() == false)
+		return prg_ram[addr & 0x1FFF];
+
+	return 0;
+}
+
+inline uint8_t Mapper::readCHR(uint16_t addr) const
+{
+	return chr_pages[(addr >> 10) & 0x07][addr & 0x03FF];
+}
+
+inline void Mapper::writeCHR(uint16_t addr, uint8_t data)
+{
+	if (chr_writable == true)
+		chr_pages[(addr >> 10) & 0x07][addr & 0x03FF] = data;
+}
+
+inline const uint8_t *Mapper::chrPage(size_t page) const
+{
+	return chr_pages[page & 0x07];
+}
+
+inline void Mapper::writeRAM(uint16_t addr, uint8_t data)
+{
+	if (addr >= 0x6000 && prg_ram.empty() == false)
+		prg_ram[addr & 0x1FFF] = data;
+}
\ No newline at end of file
@@ -6,17 +6,26 @@
 
 class Cartridge;
 
+// NROM: 16 or 32 KB of PRG ROM and 8 KB of CHR, no registers
 class Mapper000 : public Mapper
 {
 public:
 
+	// Created once the cartridge's ROM is loaded; keeps pointers into it
 	Mapper000(Cartridge *);
-	~Mapper000();
 
 	////////////////////
 	// Data access
 	////////////////////
 
-	uint8_t readPRG(uint16_t addr) const;
-	uint8_t readCHR(uint16_t addr) const;
-};
\ No newline at end of file
+	void writePRG(uint16_t addr, uint8_t data, uint64_t cycle);
+};
+
+////////////////////
+// Data access
+////////////////////
+
+inline void Mapper000::writePRG(uint16_t, uint8_t, uint64_t)
+{
+	// Nothing to write to; there is no PRG RAM either
+}
\ No newline at end of file
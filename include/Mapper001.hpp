@@ -0,0 +1,86 @@
+#pragma once
+
+#include "Mapper.hpp"
+
+#include <iostream>
+
+class Cartridge;
+
+// MMC1 (SxROM): PRG and CHR banks and mirroring, set through a serial port
+// that takes a register one bit per write
+class Mapper001 : public Mapper
+{
+public:
+
+	Mapper001(Cartridge *);
+
+	////////////////////
+	// Data access
+	////////////////////
+
+	void writePRG(uint16_t addr, uint8_t data, uint64_t cycle);
+
+private:
+
+	////////////////////
+	// Serial port
+	////////////////////
+
+	// Bits enter at bit 4. The 1 loaded on reset reaches bit 0 after four
+	// writes, so the fifth needs no counter to know it completes a register.
+	uint8_t shift { 0x10 };
+
+	// CPU cycle of the last write to the port
+	uint64_t last_write { UINT64_MAX };
+
+	////////////////////
+	// Registers
+	////////////////////
+
+	uint8_t control { 0x0C }; // mirroring, PRG and CHR modes
+	uint8_t chr_bank_0 {};
+	uint8_t chr_bank_1 {};
+	uint8_t prg_bank {};
+
+	void writeRegister(uint16_t addr, uint8_t data);
+	void updateBanks();
+};
+
+////////////////////
+// Data access
+////////////////////
+
+inline void Mapper001::writePRG(uint16_t addr, uint8_t data, uint64_t cycle)
+{
+	if (addr < 0x8000)
+	{
+		writeRAM(addr, data);
+		return;
+	}
+
+	// The port ignores a write on the cycle after another. Within one
+	// instruction only a read-modify-write stores twice, and its second
+	// store is the one lost.
+	const bool consecutive = cycle == last_write;
+	last_write = cycle;
+
+	if (consecutive == true)
+		return;
+
+	if ((data & 0x80) != 0)
+	{
+		shift = 0x10;
+		control |= 0x0C;
+		updateBanks();
+		return;
+	}
+
+	const bool complete = (shift & 0x01) != 0;
+	shift = (shift >> 1) | ((data & 0x01) << 4);
+
+	if (complete == true)
+	{
+		writeRegister(addr, shift);
+		shift = 0x10;
+	}
+}
\ No newline at end of file
@@ -0,0 +1,31 @@
+#pragma once
+
+#include "Mapper.hpp"
+
+#include <iostream>
+
+class Cartridge;
+
+// UxROM: a 16 KB PRG bank switched at $8000, the last one fixed at $C000
+class Mapper002 : public Mapper
+{
+public:
+
+	Mapper002(Cartridge *);
+
+	////////////////////
+	// Data access
+	////////////////////
+
+	void writePRG(uint16_t addr, uint8_t data, uint64_t cycle);
+};
+
+////////////////////
+// Data access
+////////////////////
+
+inline void Mapper002::writePRG(uint16_t addr, uint8_t data, uint64_t)
+{
+	if (addr >= 0x8000)
+		mapPRG(0, 0x4000, data);
+}
\ No newline at end of file
@@ -0,0 +1,31 @@
+#pragma once
+
+#include "Mapper.hpp"
+
+#include <iostream>
+
+class Cartridge;
+
+// CNROM: NROM's PRG layout with an 8 KB CHR bank switched by any write
+class Mapper003 : public Mapper
+{
+public:
+
+	Mapper003(Cartridge *);
+
+	////////////////////
+	// Data access
+	////////////////////
+
+	void writePRG(uint16_t addr, uint8_t data, uint64_t cycle);
+};
+
+////////////////////
+// Data access
+////////////////////
+
+inline void Mapper003::writePRG(uint16_t addr, uint8_t data, uint64_t)
+{
+	if (addr >= 0x8000)
+		mapCHR(0, 0x2000, data);
+}
\ No newline at end of file
@@ -0,0 +1,66 @@
+#pragma once
+
+#include "Mapper.hpp"
+
+#include <array>
+#include <iostream>
+
+class Cartridge;
+
+// MMC3 (TxROM): 8 KB PRG and 1-2 KB CHR banks, PRG RAM, and an IRQ after a
+// set number of rendered lines, counted by the rises of PPU A12
+class Mapper004 : public Mapper
+{
+public:
+
+	Mapper004(Cartridge *);
+
+	////////////////////
+	// Data access
+	////////////////////
+
+	void writePRG(uint16_t addr, uint8_t data, uint64_t cycle);
+
+	////////////////////
+	// A12
+	////////////////////
+
+	void a12Changed();
+	void clockA12();
+
+private:
+
+	////////////////////
+	// Banks
+	////////////////////
+
+	uint8_t bank_select {}; // register written next, PRG and CHR layout
+	std::array<uint8_t, 8> registers { 0, 2, 4, 5, 6, 7, 0, 1 };
+
+	// Four-screen boards ignore the mirroring register
+	bool four_screen {};
+
+	void updateBanks();
+
+	////////////////////
+	// IRQ
+	////////////////////
+
+	uint8_t irq_latch {};
+	uint8_t irq_counter {};
+	bool irq_reload {};
+	bool irq_enabled {};
+	bool irq_line {};
+
+	// The counter is only brought up to date when something reads or
+	// changes it. Until then it is clocked by the A12 rises the PPU makes
+	// after synced at a12_dot, which stays put until the PPU reports it
+	// moved. The next IRQ is scheduled on the cartridge from the same
+	// prediction instead of being watched for.
+	uint64_t synced {};
+	size_t a12_dot {};
+
+	void sync();
+	void clock(uint64_t count);
+	void schedule();
+};
\ No newline at end of file
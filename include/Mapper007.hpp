@@ -0,0 +1,32 @@
+#pragma once
+
+#include "Mapper.hpp"
+
+class Cartridge;
+
+// AxROM: a 32 KB PRG bank and a single-screen nametable picked by one write
+class Mapper007 : public Mapper
+{
+public:
+
+	Mapper007(Cartridge *);
+
+	////////////////////
+	// Data access
+	////////////////////
+
+	void writePRG(uint16_t addr, uint8_t data, uint64_t cycle);
+};
+
+////////////////////
+// Data access
+////////////////////
+
+inline void Mapper007::writePRG(uint16_t addr, uint8_t data, uint64_t)
+{
+	if (addr < 0x8000)
+		return;
+
+	mapPRG(0, 0x8000, data & 0x0F);
+	mirrorSingleScreen((data & 0x10) != 0);
+}
\ No newline at end of file
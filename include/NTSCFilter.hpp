@@ -0,0 +1,111 @@
+#pragma once
+
+#include "PPU.hpp"
+
+#include <array>
+#include <condition_variable>
+#include <cstdint>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+// Rebuilds the composite signal the PPU puts out from color indexes and
+// emphasis bits, then decodes it as a television would, so dot crawl,
+// color fringing on sharp edges and emphasis tinting come from the signal
+// instead of a fixed palette. Each line is 8 samples per pixel at 12
+// samples per color subcarrier cycle; frames are decoded in horizontal
+// bands on worker threads.
+class NTSCFilter
+{
+public:
+
+	NTSCFilter();
+	~NTSCFilter();
+
+	// Pixels per decoded line, 4 samples each
+	static constexpr size_t OUT_W { SCREEN_W * 2 };
+
+	// Decodes a frame into SCREEN_H rows of OUT_W ARGB pixels, stride
+	// pixels apart. The colorburst phase alternates between frames as the
+	// dot skipped on odd frames makes it.
+	void apply(
+		const uint8_t pixels[SCREEN_H][SCREEN_W],
+		const uint8_t *emphasis,
+		size_t frame_number,
+		uint32_t *out,
+		size_t stride
+	);
+
+private:
+
+	////////////////////
+	// Signal
+	////////////////////
+
+	static constexpr size_t SAMPLES_PER_PIXEL { 8 };
+	static constexpr size_t PHASES { 12 };
+
+	// Level of every color under every emphasis at every subcarrier phase,
+	// already multiplied by the decoder's carrier so decoding is a plain
+	// convolution; indexed by (emphasis << 6) | color
+	using Table = std::array<std::array<float, PHASES>, 512>;
+
+	Table luma {};
+	Table in_phase {};
+	Table quadrature {};
+
+	void buildTables();
+
+	////////////////////
+	// Decoder
+	////////////////////
+
+	// Low-pass filters applied around every output pixel
+	static constexpr size_t TAPS { 16 };
+
+	std::array<float, TAPS> luma_kernel {};
+	std::array<float, TAPS> chroma_kernel {};
+
+	// One line of demodulated samples, split by sample index modulo 4 so
+	// consecutive output pixels read consecutive floats for every tap
+	static constexpr size_t PAD { 8 };
+	static constexpr size_t GROUPS { (SCREEN_W * SAMPLES_PER_PIXEL + 2 * PAD) / 4 + 4 };
+
+	struct Line
+	{
+		alignas(32) float Y[4][GROUPS];
+		alignas(32) float I[4][GROUPS];
+		alignas(32) float Q[4][GROUPS];
+	};
+
+	void encodeLine(const uint8_t *pixels, uint8_t emphasis, size_t phase, Line&) const;
+	void decodeLine(const Line&, uint32_t *out) const;
+
+	////////////////////
+	// Workers
+	////////////////////
+
+	struct Job
+	{
+		const uint8_t (*pixels)[SCREEN_W];
+		const uint8_t *emphasis;
+		size_t phase;
+		uint32_t *out;
+		size_t stride;
+	};
+
+	Job current {};
+
+	size_t band_count {};
+	std::vector<std::thread> workers;
+
+	std::mutex mutex;
+	std::condition_variable work_ready;
+	std::condition_variable work_done;
+
+	size_t job {};
+	size_t remaining {};
+	bool stopping {};
+
+	void work(size_t band);
+};
\ No newline at end of file
@@ -1,8 +1,14 @@
 #pragma once
 
+#include "Cartridge.hpp"
+
 #include <array>
+#include <cstddef>
 #include <cstdint>
+#include <memory>
+#include <vector>
 
+class BandRenderer;
 class Bus;
 
 constexpr size_t NAMETABLE_W { 32 };
@@ -19,6 +25,10 @@ public:
 	PPU(Bus&);
 	~PPU();
 
+	// Render each frame on worker threads from a log of the writes made
+	// while it was drawn, instead of inline as scanlines are reached
+	void setDeferredRendering(bool enabled);
+
 	////////////////////
 	// Data access
 	////////////////////
@@ -36,7 +46,30 @@ public:
 	size_t cycles {};
 	size_t scanlines {};
 
-	void step(uint8_t ppu_cycles);
+	// PPU cycles run since power on
+	uint64_t dots {};
+
+	void step(uint16_t ppu_cycles);
+
+	////////////////////
+	// A12
+	////////////////////
+
+	// Rendering raises PPU address line A12 once on every rendered line
+	// (0-239 and 261), where pattern fetches move from the $0000 table to
+	// $1000: at dot 260 with only the sprites there, at dot 324 with only
+	// the background. Mappers that count lines (MMC3) predict from this
+	// instead of watching every fetch.
+	static constexpr size_t A12_NONE { 0 };  // no rises with these registers
+	static constexpr size_t A12_EDGES { 1 }; // 8x16 sprites; reported per line
+
+	size_t a12Dot() const;
+
+	// Rises at a12_dot of every rendered line before PPU cycle dot
+	static uint64_t a12Rises(uint64_t dot, size_t a12_dot);
+
+	// PPU cycle by which count more rises than by dot have happened
+	static uint64_t a12After(uint64_t dot, size_t a12_dot, uint64_t count);
 
 	////////////////////
 	// Palettes
@@ -45,27 +78,48 @@ public:
 	// stores indexes
 	std::array<uint8_t, 32> vram_palettes {};
 
+	uint8_t readPalette(uint16_t addr) const;
+	void writePalette(uint16_t addr, uint8_t data);
+
+	// ARGB for every color under every emphasis combination, indexed by
+	// (emphasis << 6) | color
+	std::array<uint32_t, 512> color_lut {};
+
 	////////////////////
 	// Nametables
 	////////////////////
 
 	using Nametable = std::array<uint8_t, 0x400>;
 
+	// 0-1 are the console's 2 KB, 2-3 the cartridge's four-screen VRAM
 	Nametable nametable_0 {};
 	Nametable nametable_1 {};
 	Nametable nametable_2 {};
 	Nametable nametable_3 {};
 
-	const Nametable& getNametable() const;
+	// Physical nametable behind each of $2000, $2400, $2800 and $2C00
+	std::array<size_t, 4> nametable_map {};
+	std::array<Nametable *, 4> nametables {};
 
-	void getPalettes(
-		size_t X,
-		size_t Y,
-		uint8_t& col_0,
-		uint8_t& col_1,
-		uint8_t& col_2,
-		uint8_t& col_3
-	);
+	void setMirroring(Cartridge::Mirroring);
+
+	const Nametable& getNametable(size_t index) const;
+	void writeNametable(size_t index, uint16_t offset, uint8_t data);
+
+	////////////////////
+	// Pattern tables
+	////////////////////
+
+	void markPatternDirty(uint16_t addr);
+	void markPatternPageDirty(size_t page);
+
+	////////////////////
+	// Sprites
+	////////////////////
+
+	std::array<uint8_t, 256> OAM {};
+
+	void writeOAM(const uint8_t *page);
 
 	////////////////////
 	// Frame
@@ -73,12 +127,39 @@ public:
 
 	bool update_screen {};
 
-	using Tile = std::array<uint8_t, 8 * 8>;
+	// false when no scanline of the completed frame differs from the last
+	bool frame_dirty {};
 
-	uint32_t buffer[SCREEN_H][SCREEN_W];
+	// Set by the host before a frame starts to leave its pixels undrawn.
+	// Timing, NMI, sprite 0 hit, sprite overflow and PPUSTATUS are kept
+	// exact; rows drawn later catch up through dirty tracking.
+	bool skip_frame {};
 
-	const Tile getTile(uint8_t id) const;
-	void updateBuffer();
+	// Color index (0-63, greyscale applied) of every pixel, and the
+	// PPUMASK emphasis bits each line was drawn with; color_lut turns the
+	// pair into ARGB at presentation
+	uint8_t buffer[SCREEN_H][SCREEN_W];
+	std::array<uint8_t, SCREEN_H> emphasis {};
+
+	// Scanlines of the current frame already drawn into buffer, so a
+	// partial frame can be presented; stays 0 for skipped and deferred frames
+	size_t rows_ready {};
+
+	////////////////////
+	// Dirty tracking
+	////////////////////
+
+	struct DirtyStats
+	{
+		size_t frames;         // frames completed
+		size_t frames_reused;  // frames identical to the previous one
+		size_t frames_skipped; // frames left undrawn through skip_frame
+		size_t rows_rendered;  // scanlines written to buffer
+		size_t rows_reused;    // scanlines left as they were
+		size_t tiles_rendered; // 8-pixel tile rows fetched and decoded
+	};
+
+	DirtyStats dirty_stats {};
 
 private:
 
@@ -101,11 +182,19 @@ private:
 
 	std::array<uint32_t, 64> palettes {};
 
+	// vram_palettes with the greyscale mask applied, refreshed only on
+	// palette writes and greyscale changes
+	std::array<uint8_t, 32> active_palette {};
+
+	void buildColorLUT();
+	void resolvePalette(size_t index);
+	void resolvePalettes();
+
 	////////////////////
 	// Registers
 	////////////////////
 
-	union
+	union Control
 	{
 		struct
 		{
@@ -121,7 +210,7 @@ private:
 		uint8_t val;
 	} PPUCTRL {};
 
-	union
+	union Mask
 	{
 		struct
 		{
@@ -155,16 +244,16 @@ private:
 	{
 		struct
 		{
-			unsigned coarse_x : 5;
-			uint8_t coarse_y  : 5;
-			uint8_t nt_select : 2;
-			uint8_t fine_y    : 3;
+			uint16_t coarse_x  : 5;
+			uint16_t coarse_y  : 5;
+			uint16_t nt_select : 2;
+			uint16_t fine_y    : 3;
 		};
 
 		struct
 		{
-			unsigned l : 8;
-			unsigned h : 7;
+			uint16_t l : 8;
+			uint16_t h : 7;
 		};
 
 		uint16_t val;
@@ -175,4 +264,191 @@ private:
 	uint8_t fine_x_scroll {};
 	uint8_t internal_buffer {};
 	bool latch {};
+
+	////////////////////
+	// Rendering
+	////////////////////
+
+	// Register state a scanline is drawn with, sampled at dot 257
+	struct LineState
+	{
+		LoopyAddress v;
+		uint8_t fine_x;
+		Control ctrl;
+		Mask mask;
+	};
+
+	// Memory a scanline is drawn from: nametables, 1 KB CHR pages and the
+	// resolved palette
+	struct RenderSource
+	{
+		std::array<const Nametable *, 4> nametables;
+		std::array<const uint8_t *, 8> patterns;
+		const uint8_t *colors;
+	};
+
+	struct Sprite
+	{
+		uint8_t Y;
+		uint8_t tile;
+		uint8_t attributes;
+		uint8_t X;
+	};
+
+	// Palette RAM index (bits 0-4) of the frontmost opaque sprite pixel
+	static constexpr uint8_t SPRITE_BEHIND { 0x20 };
+
+	// Palette RAM index of every background pixel, 0 for the backdrop
+	uint8_t bg_index[SCREEN_H][SCREEN_W] {};
+
+	// What each scanline was last drawn from
+	struct RowCache
+	{
+		uint16_t vram_addr;
+		uint8_t fine_x;
+		uint8_t mode;
+		uint32_t generation;
+		uint32_t palette_generation;
+		bool sprites;
+	};
+
+	std::array<RowCache, SCREEN_H> row_cache {};
+
+	// Bumped on every write that changes what a tile or color looks like;
+	// a row is stale when anything it reads is newer than the row
+	uint32_t generation { 1 };
+	uint32_t palette_generation { 1 };
+
+	std::array<std::array<uint32_t, 0x400>, 4> tile_generation {};
+	std::array<uint32_t, 512> pattern_generation {};
+
+	size_t rows_changed {};
+
+	bool renderingEnabled() const;
+
+	RenderSource liveSource() const;
+	LineState liveLine() const;
+
+	void renderScanline(size_t line);
+	void finishFrame();
+
+	static uint8_t readPattern(const RenderSource&, uint16_t addr);
+	static void nextTile(LoopyAddress& v);
+
+	static uint8_t fetchTile(
+		const RenderSource&,
+		const LineState&,
+		LoopyAddress v,
+		uint8_t& lo,
+		uint8_t& hi
+	);
+
+	static void renderTile(uint8_t *row, int X, uint8_t lo, uint8_t hi, uint8_t palette);
+	static void renderBackground(const RenderSource&, const LineState&, uint8_t *row);
+
+	static void mergeRow(
+		const uint8_t *bg,
+		const uint8_t *sprites,
+		const uint8_t *colors,
+		uint8_t *out
+	);
+
+	////////////////////
+	// Sprites
+	////////////////////
+
+	uint8_t oam_addr {};
+
+	// Sprites found on the next scanline, in OAM order
+	std::array<Sprite, 8> secondary_oam {};
+	size_t sprite_count {};
+
+	std::array<uint8_t, SCREEN_W> sprite_line {};
+
+	void evaluateSprites(size_t line);
+
+	// Whether fetching the sprites found raises A12, for 8x16 sprites
+	bool spritesRaiseA12() const;
+
+	static size_t findSprites(
+		const uint8_t *oam,
+		Control ctrl,
+		size_t line,
+		Sprite *found,
+		bool& overflow
+	);
+
+	static void renderSprites(
+		const RenderSource&,
+		const LineState&,
+		size_t line,
+		const Sprite *sprites,
+		size_t count,
+		uint8_t *out
+	);
+
+	static void fetchSpriteRow(
+		const RenderSource&,
+		Control ctrl,
+		const Sprite&,
+		size_t line,
+		uint8_t& lo,
+		uint8_t& hi
+	);
+
+	////////////////////
+	// Sprite 0 hit
+	////////////////////
+
+	// Frame dot (scanline * 341 + cycle) of the next hit, predicted from
+	// OAM, scroll and VRAM instead of comparing pixels as they are drawn
+	static constexpr size_t NO_HIT { SIZE_MAX };
+
+	size_t sprite_0_dot { NO_HIT };
+	bool sprite_0_stale {};
+
+	bool backgroundOpaque(const RenderSource&, LoopyAddress v, size_t X) const;
+	void predictSprite0();
+
+	////////////////////
+	// Scrolling
+	////////////////////
+
+	void incrementY(LoopyAddress& v) const;
+	void copyX(LoopyAddress& v) const;
+	void copyY(LoopyAddress& v) const;
+
+	////////////////////
+	// Deferred rendering
+	////////////////////
+
+	friend class BandRenderer;
+
+	enum class WriteTarget : uint8_t
+	{
+		Nametable,    // physical page * 0x400 + offset
+		NametableMap, // $2000-$2C00 slot, physical page as data
+		Pattern,
+		Palette,
+		OAM
+	};
+
+	// A memory write made while a deferred frame was being drawn
+	struct Write
+	{
+		uint32_t dot;
+		WriteTarget target;
+		uint16_t addr;
+		uint8_t data;
+	};
+
+	std::unique_ptr<BandRenderer> band_renderer;
+
+	bool deferred {};  // requested
+	bool deferring {}; // recording the current frame
+	bool skipping {};  // current frame is not drawn
+	bool collected {}; // a deferred frame was drained into buffer
+
+	void beginFrame();
+	void logWrite(WriteTarget, uint16_t addr, uint8_t data);
 };
\ No newline at end of file
@@ -0,0 +1,143 @@
+#pragma once
+
+#include "FrameExchange.hpp"
+#include "NTSCFilter.hpp"
+
+#include <array>
+#include <condition_variable>
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+// Runs a scaling filter over presented frames on a worker thread, so frame
+// N is filtered while the emulator produces frame N + 1. One frame waits
+// while another is filtered; a frame arriving while both places are taken
+// replaces the waiting one, so a slow filter drops frames instead of
+// holding up the emulator or the SDL thread.
+class PostProcessor
+{
+public:
+
+	enum class Filter
+	{
+		None,      // frames go straight to the texture
+		Nearest,   // SCALE times, pixels repeated
+		Scale2x,   // EPX edge-directed 2x
+		Scale3x,   // AdvMAME3x edge-directed 3x
+		XBR,       // xBR level 1 edge detection, 2x
+		Scanlines, // 2x with every other line dimmed
+		NTSC       // composite signal decoded from color indexes, 2x
+	};
+
+	// colors: ARGB indexed by (emphasis << 6) | color
+	PostProcessor(const uint32_t *colors);
+	~PostProcessor();
+
+	static size_t scale(Filter);
+	static Filter next(Filter);
+
+	struct Image
+	{
+		std::vector<uint32_t> pixels;
+		size_t width;
+		size_t height;
+		std::string overlay;
+	};
+
+	////////////////////
+	// SDL thread
+	////////////////////
+
+	void submit(const FrameExchange::Frame&, Filter);
+
+	// Newest filtered image not taken yet, nullptr if none
+	const Image *acquire();
+
+	// Called on the worker whenever an image is ready
+	std::function<void()> on_ready;
+
+	////////////////////
+	// Statistics
+	////////////////////
+
+	struct FilterStats
+	{
+		size_t frames;    // frames filtered
+		size_t dropped;   // frames replaced while waiting
+		double filter_us; // converting and filtering, all frames
+		double max_us;    // slowest frame
+	};
+
+	FilterStats stats();
+
+private:
+
+	const uint32_t *colors;
+
+	////////////////////
+	// Queue
+	////////////////////
+
+	struct Job
+	{
+		FrameExchange::Frame frame;
+		Filter filter;
+	};
+
+	Job waiting {};
+	Job working {};
+	bool has_waiting {};
+
+	// Filled by the worker, handed over by swapping with ready
+	Image back {};
+	Image ready {};
+	Image front {};
+	bool has_ready {};
+
+	std::mutex mutex;
+	std::condition_variable work_ready;
+	bool stopping {};
+
+	FilterStats filter_stats {};
+
+	std::thread worker;
+
+	void work();
+	void process(const Job&, Image&);
+
+	////////////////////
+	// Filters
+	////////////////////
+
+	// ARGB frame with a border of repeated edge pixels so kernels can read
+	// their neighbours without bounds checks
+	static constexpr size_t BORDER { 2 };
+	static constexpr size_t PADDED_W { SCREEN_W + 2 * BORDER };
+	static constexpr size_t PADDED_H { SCREEN_H + 2 * BORDER };
+
+	std::vector<uint32_t> source;
+
+	const uint32_t *at(size_t X, size_t Y) const;
+
+	void nearest(Image&, size_t factor) const;
+	void scale2x(Image&) const;
+	void scale3x(Image&) const;
+	void xbr(Image&);
+	void scanlines(Image&) const;
+
+	// Started the first time an NTSC frame is filtered
+	std::unique_ptr<NTSCFilter> ntsc;
+
+	void composite(const FrameExchange::Frame&, Image&);
+
+	// xBR: Y, U and V of every source pixel, times 256
+	std::array<std::vector<int32_t>, 3> yuv;
+
+	// Weighted YUV difference of two source pixels, by index
+	uint32_t distance(size_t a, size_t b) const;
+	static uint32_t blend(uint32_t a, uint32_t b);
+};
\ No newline at end of file
@@ -0,0 +1,98 @@
+#pragma once
+
+#include <algorithm>
+#include <array>
+#include <atomic>
+#include <cstddef>
+
+// Lock-free ring for exactly one producer thread and one consumer thread.
+// Holds up to N - 1 items; N must be a power of two.
+template <typename T, size_t N>
+class SPSCQueue
+{
+	static_assert(N >= 2 && (N & (N - 1)) == 0);
+
+public:
+
+	// false when full, the item is dropped
+	bool push(const T& item)
+	{
+		const size_t tail = write.load(std::memory_order_relaxed);
+		const size_t next = (tail + 1) & (N - 1);
+
+		if (next == read.load(std::memory_order_acquire))
+			return false;
+
+		items[tail] = item;
+		write.store(next, std::memory_order_release);
+
+		return true;
+	}
+
+	// false when empty
+	bool pop(T& item)
+	{
+		const size_t head = read.load(std::memory_order_relaxed);
+
+		if (head == write.load(std::memory_order_acquire))
+			return false;
+
+		item = items[head];
+		read.store((head + 1) & (N - 1), std::memory_order_release);
+
+		return true;
+	}
+
+	// Bulk versions for streams such as audio; both return how many items
+	// were moved, which is short when the ring fills or empties
+	size_t push(const T *source, size_t count)
+	{
+		const size_t tail = write.load(std::memory_order_relaxed);
+		const size_t head = read.load(std::memory_order_acquire);
+
+		count = std::min(count, (head - tail - 1) & (N - 1));
+
+		const size_t first = std::min(count, N - tail);
+
+		std::copy_n(source, first, &items[tail]);
+		std::copy_n(source + first, count - first, &items[0]);
+		write.store((tail + count) & (N - 1), std::memory_order_release);
+
+		return count;
+	}
+
+	size_t pop(T *target, size_t count)
+	{
+		const size_t head = read.load(std::memory_order_relaxed);
+		const size_t tail = write.load(std::memory_order_acquire);
+
+		count = std::min(count, (tail - head) & (N - 1));
+
+		const size_t first = std::min(count, N - head);
+
+		std::copy_n(&items[head], first, target);
+		std::copy_n(&items[0], count - first, target + first);
+		read.store((head + count) & (N - 1), std::memory_order_release);
+
+		return count;
+	}
+
+	static constexpr size_t capacity()
+	{
+		return N - 1;
+	}
+
+	// Items queued; the other thread may change it right after
+	size_t size() const
+	{
+		return (write.load(std::memory_order_acquire) - read.load(std::memory_order_acquire)) & (N - 1);
+	}
+
+private:
+
+	std::array<T, N> items {};
+
+	// Kept on separate cache lines so the two threads do not contend
+	alignas(64) std::atomic<size_t> write {};
+	alignas(64) std::atomic<size_t> read {};
+};
\ No newline at end of file
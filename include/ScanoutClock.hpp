@@ -0,0 +1,58 @@
+#pragma once
+
+#include <chrono>
+#include <cstddef>
+#include <mutex>
+#include <vector>
+
+// Model of where the host display is in its scanout. SDL has no raster
+// position to read, but a vsynced present returns as the display flips at
+// the start of vblank, so the refresh period and phase are fitted to the
+// return times of a run of them. The raster line is extrapolated from the
+// fit, assuming lines are scanned at an even pace after a vertical blank.
+class ScanoutClock
+{
+public:
+
+	using Clock = std::chrono::steady_clock;
+
+	// presents: return times of consecutive vsynced presents. nominal: the
+	// display mode's refresh period, zero if unknown. False when the
+	// presents did not wait for the display, e.g. a driver forcing vsync off
+	bool calibrate(const std::vector<Clock::time_point>& presents, std::chrono::nanoseconds nominal);
+
+	// Where the window is, as fractions of its display's height, and that
+	// display's nominal refresh period; moving to a display refreshing at
+	// another rate voids the fit
+	void setWindow(double top, double height, std::chrono::nanoseconds nominal);
+
+	bool calibrated() const;
+	std::chrono::nanoseconds period() const;
+
+	// First time, no earlier than after, that the raster reaches the given
+	// fraction of the window's height
+	Clock::time_point rowTime(double fraction, Clock::time_point after) const;
+
+private:
+
+	mutable std::mutex mutex;
+
+	bool fitted {};
+
+	// A flip, i.e. the start of a vertical blank
+	Clock::time_point vsync {};
+	std::chrono::nanoseconds refresh {};
+
+	double window_top {};
+	double window_height { 1 };
+
+	// Vertical blank as a share of the refresh: 45 of 1125 lines at 1080p,
+	// 30 of 750 at 720p
+	static constexpr double VBLANK_SHARE { 0.04 };
+
+	// The first presents return before the swap chain fills; ignored
+	static constexpr size_t WARMUP { 8 };
+
+	// A fit further than this from the display mode is not vsync
+	static constexpr double MAX_DEVIATION { 0.02 };
+};
\ No newline at end of file
@@ -0,0 +1,69 @@
+#pragma once
+
+#include "FramePacer.hpp"
+#include "FrameSkip.hpp"
+
+#include <chrono>
+#include <cstddef>
+#include <string>
+
+// Paces emulated frames against host time: real time, a fixed
+// fast-forward multiple of it, or uncapped turbo
+class SpeedGovernor
+{
+public:
+
+	SpeedGovernor(FramePacer&, FrameSkip&);
+
+	enum class Mode
+	{
+		Normal,
+		FastForward,
+		Turbo
+	};
+
+	Mode mode { Mode::Normal };
+	size_t multiplier { 1 };
+
+	// Hotkey: Normal -> 2x -> 4x -> 8x -> Turbo -> Normal
+	void cycle();
+
+	// Called once per emulated frame; waits until the frame is due
+	void frame();
+
+	////////////////////
+	// Overlay
+	////////////////////
+
+	// Achieved emulation speed relative to real time
+	double speed {};
+
+	// Text shown over the picture, empty at normal speed
+	std::string label() const;
+
+private:
+
+	////////////////////
+	// Presentation
+	////////////////////
+
+	// Frame skipping outside of fast-forward and turbo
+	FrameSkip *frame_skip;
+	FrameSkip::Mode base_mode;
+	size_t base_frames;
+
+	////////////////////
+	// Pacing
+	////////////////////
+
+	FramePacer *pacer;
+
+	////////////////////
+	// Measurement
+	////////////////////
+
+	std::chrono::steady_clock::time_point window_start {};
+	size_t window_frames {};
+
+	static constexpr std::chrono::milliseconds WINDOW { 500 };
+};
\ No newline at end of file
@@ -0,0 +1,740 @@
+#include "APU.hpp"
+
+#include "Bus.hpp"
+
+#include <algorithm>
+
+////////////////////
+// Tables
+////////////////////
+
+static constexpr uint8_t LENGTH_TABLE[32] {
+	10, 254, 20,  2, 40,  4, 80,  6, 160,  8, 60, 10, 14, 12, 26, 14,
+	12,  16, 24, 18, 48, 20, 96, 22, 192, 24, 72, 26, 16, 28, 32, 30
+};
+
+// Output of each duty cycle at sequencer steps 0-7, one bit per step
+static constexpr uint8_t DUTY_TABLE[4] { 0b00000010, 0b00000110, 0b00011110, 0b11111001 };
+
+static constexpr uint8_t TRIANGLE_TABLE[32] {
+	15, 14, 13, 12, 11, 10,  9,  8,  7,  6,  5,  4,  3,  2,  1,  0,
+	 0,  1,  2,  3,  4,  5,  6,  7,  8,  9, 10, 11, 12, 13, 14, 15
+};
+
+// Timer periods in CPU cycles, NTSC
+static constexpr uint16_t NOISE_TABLE[16] {
+	4, 8, 16, 32, 64, 96, 128, 160, 202, 254, 380, 508, 762, 1016, 2034, 4068
+};
+
+static constexpr uint16_t DMC_TABLE[16] {
+	428, 380, 340, 320, 286, 254, 226, 214, 190, 160, 142, 128, 106, 84, 72, 54
+};
+
+// CPU cycles from the start of a frame counter sequence to each of its
+// steps, and the length of the sequence
+static constexpr uint64_t FOUR_STEP[4] { 7457, 14913, 22371, 29829 };
+static constexpr uint64_t FIVE_STEP[5] { 7457, 14913, 22371, 29829, 37281 };
+
+static constexpr uint64_t FOUR_STEP_PERIOD { 29830 };
+static constexpr uint64_t FIVE_STEP_PERIOD { 37282 };
+
+// Longest stretch synthesized without endFrame before it is ended anyway
+static constexpr uint64_t MAX_FRAME { 1 << 16 };
+
+APU::APU(Bus& bus_ref)
+	: bus { &bus_ref }
+	, blip { CPU_CLOCK, SAMPLE_RATE, 4096 }
+	, blip_right { CPU_CLOCK, SAMPLE_RATE, 4096 }
+{
+	for (size_t n { 1 }; n < pulse_table.size(); ++n)
+		pulse_table[n] = static_cast<float>(95.52 / (8128.0 / n + 100));
+
+	for (size_t n { 1 }; n < tnd_table.size(); ++n)
+		tnd_table[n] = static_cast<float>(163.67 / (24329.0 / n + 100));
+
+	pulse_1.negate_offset = 1;
+
+	// Pulses and noise are idle until their length counters are loaded,
+	// the triangle until it can step
+	pulse_1.next = NEVER;
+	pulse_2.next = NEVER;
+	triangle.next = NEVER;
+	noise.next = NEVER;
+
+	noise.shift = 1;
+	noise.period = NOISE_TABLE[0];
+
+	dmc.period = DMC_TABLE[0];
+	dmc.bits = 8;
+	dmc.silence = true;
+	dmc.next = dmc.period;
+}
+
+APU::~APU()
+{
+}
+
+////////////////////
+// Data access
+////////////////////
+
+void APU::writeRegister(uint16_t addr, uint8_t data)
+{
+	catchUp();
+
+	switch (addr)
+	{
+	// Pulse 1 and 2
+	case 0x4000:
+	case 0x4004:
+	{
+		Pulse& pulse = (addr < 0x4004) ? pulse_1 : pulse_2;
+
+		pulse.duty = data >> 6;
+		pulse.halt = data & 0x20;
+		pulse.envelope.loop = data & 0x20;
+		pulse.envelope.constant = data & 0x10;
+		pulse.envelope.volume = data & 0x0F;
+	}
+	break;
+
+	case 0x4001:
+	case 0x4005:
+	{
+		Pulse& pulse = (addr < 0x4004) ? pulse_1 : pulse_2;
+
+		pulse.sweep_enabled = data & 0x80;
+		pulse.sweep_period = (data >> 4) & 0x07;
+		pulse.sweep_negate = data & 0x08;
+		pulse.sweep_shift = data & 0x07;
+		pulse.sweep_reload = true;
+	}
+	break;
+
+	case 0x4002:
+	case 0x4006:
+	{
+		Pulse& pulse = (addr < 0x4004) ? pulse_1 : pulse_2;
+
+		pulse.period = (pulse.period & 0x0700) | data;
+	}
+	break;
+
+	case 0x4003:
+	case 0x4007:
+	{
+		Pulse& pulse = (addr < 0x4004) ? pulse_1 : pulse_2;
+
+		pulse.period = (pulse.period & 0x00FF) | ((data & 0x07) << 8);
+		pulse.step = 0;
+		pulse.envelope.start = true;
+
+		if (pulse.enabled == true)
+			pulse.length = LENGTH_TABLE[data >> 3];
+
+		if (pulse.length > 0 && pulse.next == NEVER)
+			pulse.next = time + 2 * (pulse.period + 1);
+	}
+	break;
+
+	// Triangle
+	case 0x4008:
+		triangle.control = data & 0x80;
+		triangle.linear_load = data & 0x7F;
+		break;
+
+	case 0x400A:
+		triangle.period = (triangle.period & 0x0700) | data;
+		break;
+
+	case 0x400B:
+		triangle.period = (triangle.period & 0x00FF) | ((data & 0x07) << 8);
+		triangle.linear_reload = true;
+
+		if (triangle.enabled == true)
+			triangle.length = LENGTH_TABLE[data >> 3];
+		break;
+
+	// Noise
+	case 0x400C:
+		noise.halt = data & 0x20;
+		noise.envelope.loop = data & 0x20;
+		noise.envelope.constant = data & 0x10;
+		noise.envelope.volume = data & 0x0F;
+		break;
+
+	case 0x400E:
+		noise.mode = data & 0x80;
+		noise.period = NOISE_TABLE[data & 0x0F];
+		break;
+
+	case 0x400F:
+		noise.envelope.start = true;
+
+		if (noise.enabled == true)
+			noise.length = LENGTH_TABLE[data >> 3];
+
+		if (noise.length > 0 && noise.next == NEVER)
+			noise.next = time + noise.period;
+		break;
+
+	// DMC
+	case 0x4010:
+		dmc.irq_enabled = data & 0x80;
+		dmc.loop = data & 0x40;
+		dmc.period = DMC_TABLE[data & 0x0F];
+
+		if (dmc.irq_enabled == false)
+			dmc_irq = false;
+		break;
+
+	case 0x4011:
+		dmc.level = data & 0x7F;
+		break;
+
+	case 0x4012:
+		dmc.sample_addr = 0xC000 + data * 64;
+		break;
+
+	case 0x4013:
+		dmc.sample_length = data * 16 + 1;
+		break;
+
+	// Status
+	case 0x4015:
+		pulse_1.enabled = data & 0x01;
+		pulse_2.enabled = data & 0x02;
+		triangle.enabled = data & 0x04;
+		noise.enabled = data & 0x08;
+
+		if (pulse_1.enabled == false)
+			pulse_1.length = 0;
+		if (pulse_2.enabled == false)
+			pulse_2.length = 0;
+		if (triangle.enabled == false)
+			triangle.length = 0;
+		if (noise.enabled == false)
+			noise.length = 0;
+
+		dmc_irq = false;
+
+		if ((data & 0x10) == 0)
+			dmc.remaining = 0;
+		else if (dmc.remaining == 0)
+		{
+			dmc.addr = dmc.sample_addr;
+			dmc.remaining = dmc.sample_length;
+			fetchSample();
+		}
+		break;
+
+	// Frame counter
+	case 0x4017:
+		five_step = data & 0x80;
+		irq_inhibit = data & 0x40;
+
+		if (irq_inhibit == true)
+			frame_irq = false;
+
+		frame_start = time;
+		frame_step = 0;
+
+		// The 5-step sequence clocks everything as it starts
+		if (five_step == true)
+		{
+			quarterFrame();
+			halfFrame();
+		}
+		break;
+	}
+
+	scheduleTriangle();
+	scheduleIRQ();
+	updateOutput(time);
+}
+
+uint8_t APU::readStatus(bool read_only)
+{
+	catchUp();
+
+	const uint8_t data = (pulse_1.length > 0)
+		| ((pulse_2.length > 0) << 1)
+		| ((triangle.length > 0) << 2)
+		| ((noise.length > 0) << 3)
+		| ((dmc.remaining > 0) << 4)
+		| (frame_irq << 6)
+		| (dmc_irq << 7);
+
+	if (read_only == false)
+		frame_irq = false;
+
+	return data;
+}
+
+////////////////////
+// Timing
+////////////////////
+
+void APU::catchUp()
+{
+	const uint64_t target = bus->cpu_cycles;
+
+	if (target == time)
+		return;
+
+	// Nothing is reading the output; keep the blip frame inside its buffer
+	while (target - blip_start >= MAX_FRAME)
+	{
+		run(blip_start + MAX_FRAME);
+		endBlipFrame();
+	}
+
+	run(target);
+	scheduleIRQ();
+}
+
+void APU::run(uint64_t target)
+{
+	while (true)
+	{
+		const uint64_t frame_event = nextFrameEvent();
+
+		const uint64_t at = std::min({
+			pulse_1.next,
+			pulse_2.next,
+			triangle.next,
+			noise.next,
+			dmc.next,
+			frame_event
+		});
+
+		if (at > target)
+			break;
+
+		time = at;
+
+		// Simultaneous events always run in the same order
+		if (pulse_1.next == at)
+			clockPulse(pulse_1);
+		else if (pulse_2.next == at)
+			clockPulse(pulse_2);
+		else if (triangle.next == at)
+			clockTriangle();
+		else if (noise.next == at)
+			clockNoise();
+		else if (dmc.next == at)
+			clockDMC();
+		else
+			clockFrameCounter();
+	}
+
+	time = target;
+}
+
+////////////////////
+// Interrupts
+////////////////////
+
+bool APU::irq()
+{
+	// Polled before every instruction, so only a comparison until the
+	// line can actually rise
+	if (bus->cpu_cycles >= irq_at)
+		catchUp();
+
+	return frame_irq == true || dmc_irq == true;
+}
+
+void APU::scheduleIRQ()
+{
+	uint64_t frame = NEVER;
+	uint64_t sample = NEVER;
+
+	// The 4-step sequence raises it at its last step
+	if (five_step == false && irq_inhibit == false)
+		frame = frame_start + FOUR_STEP[3];
+
+	// The fetch that empties a sample raises it. The buffer is refilled
+	// whenever the shifter takes it, so the remaining fetches happen at
+	// the end of the current byte and of every byte after it.
+	if (dmc.irq_enabled == true && dmc.loop == false && dmc.remaining > 0)
+		sample = dmc.next + (dmc.bits - 1) * dmc.period + (dmc.remaining - 1) * 8 * dmc.period;
+
+	irq_at = std::min(frame, sample);
+}
+
+////////////////////
+// Channels
+////////////////////
+
+uint8_t APU::Envelope::output() const
+{
+	return (constant == true) ? volume : decay;
+}
+
+void APU::Envelope::clock()
+{
+	if (start == true)
+	{
+		start = false;
+		decay = 15;
+		divider = volume;
+	} else if (divider == 0)
+	{
+		divider = volume;
+
+		if (decay > 0)
+			decay--;
+		else if (loop == true)
+			decay = 15;
+	} else
+	{
+		divider--;
+	}
+}
+
+uint16_t APU::Pulse::sweepTarget() const
+{
+	const int change = period >> sweep_shift;
+	const int target = (sweep_negate == true) ? period - change - negate_offset : period + change;
+
+	return static_cast<uint16_t>(std::max(target, 0));
+}
+
+bool APU::Pulse::muted() const
+{
+	return period < 8 || sweepTarget() > 0x07FF;
+}
+
+uint8_t APU::Pulse::output() const
+{
+	if (length == 0 || muted() == true || ((DUTY_TABLE[duty] >> step) & 0x01) == 0)
+		return 0;
+
+	return envelope.output();
+}
+
+void APU::Pulse::clockSweep()
+{
+	if (sweep_divider == 0 && sweep_enabled == true && sweep_shift > 0 && muted() == false)
+		period = sweepTarget();
+
+	if (sweep_divider == 0 || sweep_reload == true)
+	{
+		sweep_divider = sweep_period;
+		sweep_reload = false;
+	} else
+	{
+		sweep_divider--;
+	}
+}
+
+uint8_t APU::Triangle::output() const
+{
+	return TRIANGLE_TABLE[step];
+}
+
+uint8_t APU::Noise::output() const
+{
+	if (length == 0 || (shift & 0x01) == 1)
+		return 0;
+
+	return envelope.output();
+}
+
+void APU::clockPulse(Pulse& pulse)
+{
+	// The sequencer steps every other CPU cycle times period + 1; with the
+	// length counter empty its phase no longer matters until $4003/$4007
+	// restarts it
+	pulse.step = (pulse.step - 1) & 0x07;
+	pulse.next = (pulse.length > 0) ? pulse.next + 2 * (pulse.period + 1) : NEVER;
+
+	updateOutput(time);
+}
+
+void APU::clockTriangle()
+{
+	triangle.step = (triangle.step + 1) & 0x1F;
+	triangle.next += triangle.period + 1;
+
+	scheduleTriangle();
+	updateOutput(time);
+}
+
+void APU::scheduleTriangle()
+{
+	// The sequencer only steps with both counters loaded; periods below 2
+	// are ultrasonic and are held instead of stepped every cycle
+	const bool running = triangle.length > 0 && triangle.linear > 0 && triangle.period >= 2;
+
+	if (running == false)
+		triangle.next = NEVER;
+	else if (triangle.next == NEVER)
+		triangle.next = time + triangle.period + 1;
+}
+
+void APU::clockNoise()
+{
+	const uint16_t tap = (noise.mode == true) ? 6 : 1;
+	const uint16_t feedback = (noise.shift ^ (noise.shift >> tap)) & 0x01;
+
+	noise.shift = (noise.shift >> 1) | (feedback << 14);
+	noise.next = (noise.length > 0) ? noise.next + noise.period : NEVER;
+
+	updateOutput(time);
+}
+
+void APU::clockDMC()
+{
+	dmc.next += dmc.period;
+
+	if (dmc.silence == false)
+	{
+		if ((dmc.shift & 0x01) == 1 && dmc.level <= 125)
+			dmc.level += 2;
+		else if ((dmc.shift & 0x01) == 0 && dmc.level >= 2)
+			dmc.level -= 2;
+	}
+
+	dmc.shift >>= 1;
+
+	if (--dmc.bits == 0)
+	{
+		dmc.bits = 8;
+		dmc.silence = (dmc.buffer_full == false);
+
+		if (dmc.buffer_full == true)
+		{
+			dmc.shift = dmc.buffer;
+			dmc.buffer_full = false;
+			fetchSample();
+		}
+	}
+
+	updateOutput(time);
+}
+
+void APU::fetchSample()
+{
+	if (dmc.buffer_full == true || dmc.remaining == 0)
+		return;
+
+	// The CPU is stalled for up to 4 cycles by this read; not modelled
+	dmc.buffer = bus->cpuRead(dmc.addr);
+	dmc.buffer_full = true;
+	dmc.addr = (dmc.addr == 0xFFFF) ? 0x8000 : dmc.addr + 1;
+
+	if (--dmc.remaining > 0)
+		return;
+
+	if (dmc.loop == true)
+	{
+		dmc.addr = dmc.sample_addr;
+		dmc.remaining = dmc.sample_length;
+	} else if (dmc.irq_enabled == true)
+	{
+		dmc_irq = true;
+	}
+}
+
+////////////////////
+// Frame counter
+////////////////////
+
+uint64_t APU::nextFrameEvent() const
+{
+	return frame_start + ((five_step == true) ? FIVE_STEP[frame_step] : FOUR_STEP[frame_step]);
+}
+
+void APU::clockFrameCounter()
+{
+	if (five_step == false)
+	{
+		quarterFrame();
+
+		if (frame_step == 1 || frame_step == 3)
+			halfFrame();
+
+		if (frame_step == 3 && irq_inhibit == false)
+			frame_irq = true;
+
+		if (++frame_step == 4)
+		{
+			frame_step = 0;
+			frame_start += FOUR_STEP_PERIOD;
+		}
+	} else
+	{
+		// Step 3 of the 5-step sequence clocks nothing
+		if (frame_step != 3)
+			quarterFrame();
+
+		if (frame_step == 1 || frame_step == 4)
+			halfFrame();
+
+		if (++frame_step == 5)
+		{
+			frame_step = 0;
+			frame_start += FIVE_STEP_PERIOD;
+		}
+	}
+
+	scheduleTriangle();
+	updateOutput(time);
+}
+
+void APU::quarterFrame()
+{
+	pulse_1.envelope.clock();
+	pulse_2.envelope.clock();
+	noise.envelope.clock();
+
+	if (triangle.linear_reload == true)
+		triangle.linear = triangle.linear_load;
+	else if (triangle.linear > 0)
+		triangle.linear--;
+
+	if (triangle.control == false)
+		triangle.linear_reload = false;
+}
+
+void APU::halfFrame()
+{
+	for (Pulse *pulse : { &pulse_1, &pulse_2 })
+	{
+		if (pulse->halt == false && pulse->length > 0)
+			pulse->length--;
+
+		pulse->clockSweep();
+	}
+
+	if (triangle.control == false && triangle.length > 0)
+		triangle.length--;
+
+	if (noise.halt == false && noise.length > 0)
+		noise.length--;
+}
+
+////////////////////
+// Mixer
+////////////////////
+
+float APU::mix(const std::array<float, 5>& gains) const
+{
+	const float pulse = gains[0] * pulse_1.output() + gains[1] * pulse_2.output();
+	const float tnd = 3 * gains[2] * triangle.output() + 2 * gains[3] * noise.output() + gains[4] * dmc.level;
+
+	return ((pulse > 0) ? 95.52f / (8128.0f / pulse + 100) : 0)
+		+ ((tnd > 0) ? 163.67f / (24329.0f / tnd + 100) : 0);
+}
+
+void APU::updateOutput(uint64_t at)
+{
+	if (stereo == true)
+	{
+		const float left = mix(gain_left);
+		const float right = mix(gain_right);
+
+		if (left != level)
+			blip.addDelta(at - blip_start, left - level);
+
+		if (right != level_right)
+			blip_right.addDelta(at - blip_start, right - level_right);
+
+		level = left;
+		level_right = right;
+
+		return;
+	}
+
+	const float output = pulse_table[pulse_1.output() + pulse_2.output()]
+		+ tnd_table[3 * triangle.output() + 2 * noise.output() + dmc.level];
+
+	if (output == level)
+		return;
+
+	blip.addDelta(at - blip_start, output - level);
+	level = output;
+}
+
+////////////////////
+// Output
+////////////////////
+
+void APU::endFrame()
+{
+	catchUp();
+	endBlipFrame();
+}
+
+void APU::endBlipFrame()
+{
+	blip.endFrame(time - blip_start);
+
+	if (stereo == true)
+		blip_right.endFrame(time - blip_start);
+
+	blip_start = time;
+}
+
+size_t APU::samplesAvailable() const
+{
+	return blip.available();
+}
+
+size_t APU::readSamples(float *out, size_t count)
+{
+	return blip.read(out, count);
+}
+
+size_t APU::readSamples(float *left, float *right, size_t count)
+{
+	if (stereo == false)
+	{
+		count = blip.read(left, count);
+		std::copy_n(left, count, right);
+
+		return count;
+	}
+
+	blip_right.read(right, count);
+
+	return blip.read(left, count);
+}
+
+void APU::setQuality(BlipBuffer::Quality quality)
+{
+	blip.setQuality(quality);
+	blip_right.setQuality(quality);
+}
+
+BlipBuffer::Quality APU::getQuality() const
+{
+	return blip.getQuality();
+}
+
+void APU::setRateRatio(double ratio)
+{
+	blip.setRatio(ratio);
+	blip_right.setRatio(ratio);
+}
+
+void APU::setPanning(const std::array<float, 5>& pan)
+{
+	stereo = false;
+
+	for (size_t i {}; i < pan.size(); ++i)
+	{
+		// Full level on the near side, fading out towards the far one
+		gain_left[i] = std::min(1.0f, 1.0f - pan[i]);
+		gain_right[i] = std::min(1.0f, 1.0f + pan[i]);
+
+		stereo = stereo || pan[i] != 0;
+	}
+}
+
+size_t APU::channels() const
+{
+	return (stereo == true) ? 2 : 1;
+}
\ No newline at end of file
@@ -0,0 +1,255 @@
+#include "AudioChain.hpp"
+
+#include <algorithm>
+#include <cmath>
+#include <numbers>
+
+#if defined(__AVX2__)
+#include <immintrin.h>
+#elif defined(__SSE2__)
+#include <emmintrin.h>
+#endif
+
+AudioChain::AudioChain(double in_rate, double out_rate, size_t channels_ref)
+	: channels { std::clamp<size_t>(channels_ref, 1, 2) }
+{
+	constexpr double pi { std::numbers::pi };
+
+	const double dt = 1.0 / in_rate;
+	const auto rc = [&](double cutoff) { return 1.0 / (2 * pi * cutoff); };
+
+	// High-pass: y[n] = a * (y[n - 1] + x[n] - x[n - 1]), a = RC / (RC + dt)
+	hp_90 = static_cast<float>(rc(90) / (rc(90) + dt));
+	hp_440 = static_cast<float>(rc(440) / (rc(440) + dt));
+
+	// Low-pass: y[n] = y[n - 1] + b * (x[n] - y[n - 1]), pole 1 - b
+	lp_14k = static_cast<float>(rc(14000) / (rc(14000) + dt));
+
+	resampling = (in_rate != out_rate);
+
+	if (resampling == false)
+		return;
+
+	step = static_cast<uint64_t>(std::llround(in_rate / out_rate * 4294967296.0));
+
+	// Cut off below the lower of the two Nyquist rates
+	const double cutoff = 0.90 * std::min(1.0, out_rate / in_rate);
+
+	kernel.assign(PHASES * TAPS, 0.0f);
+
+	for (size_t phase {}; phase < PHASES; ++phase)
+	{
+		float *row = &kernel[phase * TAPS];
+		double sum {};
+
+		for (size_t tap {}; tap < TAPS; ++tap)
+		{
+			// Distance from the output, which sits phase / PHASES past the
+			// middle of the kernel
+			const double x = tap - (TAPS / 2.0 - 1) - static_cast<double>(phase) / PHASES;
+			const double sinc = (x == 0) ? 1.0 : std::sin(pi * cutoff * x) / (pi * cutoff * x);
+
+			// Blackman window over the kernel
+			const double w = 2 * pi * (x + TAPS / 2.0) / TAPS;
+			const double window = 0.42 - 0.5 * std::cos(w) + 0.08 * std::cos(2 * w);
+
+			row[tap] = static_cast<float>(sinc * window);
+			sum += row[tap];
+		}
+
+		for (size_t tap {}; tap < TAPS; ++tap)
+			row[tap] = static_cast<float>(row[tap] / sum);
+	}
+}
+
+const std::vector<float>& AudioChain::process(const float *left, const float *right, size_t count)
+{
+	for (size_t c {}; c < channels; ++c)
+	{
+		Channel& channel = state[c];
+
+		const float *input = (c == 0) ? left : right;
+		const size_t start = channel.pending.size();
+
+		channel.pending.insert(channel.pending.end(), input, input + count);
+		filter(&channel.pending[start], count, channel.filters);
+
+		if (resampling == false)
+		{
+			channel.output.swap(channel.pending);
+			channel.pending.clear();
+			continue;
+		}
+
+		// Every channel steps through the same positions
+		uint64_t at = position;
+
+		channel.output.clear();
+
+		while ((at >> 32) + TAPS <= channel.pending.size())
+		{
+			const size_t phase = static_cast<size_t>(at >> (32 - PHASE_BITS)) & (PHASES - 1);
+
+			channel.output.push_back(dot(&channel.pending[at >> 32], &kernel[phase * TAPS]));
+			at += step;
+		}
+
+		channel.pending.erase(channel.pending.begin(), channel.pending.begin() + (at >> 32));
+
+		if (c == channels - 1)
+			position = at & 0xFFFFFFFF;
+	}
+
+	if (channels == 1)
+		return state[0].output;
+
+	const size_t frames = state[0].output.size();
+
+	interleaved.resize(frames * 2);
+
+	for (size_t i {}; i < frames; ++i)
+	{
+		interleaved[2 * i] = state[0].output[i];
+		interleaved[2 * i + 1] = state[1].output[i];
+	}
+
+	return interleaved;
+}
+
+////////////////////
+// Filters
+////////////////////
+
+void AudioChain::filter(float *data, size_t count, Filters& filters) const
+{
+	highPass(data, count, hp_90, filters.hp_90_x, filters.hp_90_y);
+	highPass(data, count, hp_440, filters.hp_440_x, filters.hp_440_y);
+	lowPass(data, count, lp_14k, filters.lp_14k_y);
+}
+
+void AudioChain::highPass(float *data, size_t count, float pole, float& x, float& y)
+{
+	if (count == 0)
+		return;
+
+	const float last = data[count - 1];
+
+	// Input term pole * (x[n] - x[n - 1]), from the end back so every
+	// x[n - 1] is read before it is replaced
+	size_t n = count;
+
+#ifdef __SSE2__
+
+	const __m128 scale = _mm_set1_ps(pole);
+
+	for (; n >= 5; n -= 4)
+	{
+		const __m128 current = _mm_loadu_ps(&data[n - 4]);
+		const __m128 previous = _mm_loadu_ps(&data[n - 5]);
+
+		_mm_storeu_ps(&data[n - 4], _mm_mul_ps(scale, _mm_sub_ps(current, previous)));
+	}
+
+#endif
+
+	for (; n > 1; --n)
+		data[n - 1] = pole * (data[n - 1] - data[n - 2]);
+
+	data[0] = pole * (data[0] - x);
+	x = last;
+
+	recurse(data, count, pole, y);
+}
+
+void AudioChain::lowPass(float *data, size_t count, float pole, float& y)
+{
+	const float gain = 1.0f - pole;
+
+	for (size_t n {}; n < count; ++n)
+		data[n] *= gain;
+
+	recurse(data, count, pole, y);
+}
+
+void AudioChain::recurse(float *data, size_t count, float pole, float& y)
+{
+	size_t n {};
+
+#ifdef __SSE2__
+
+	// Each block of four is a prefix sum weighted by powers of the pole,
+	// plus the previous output carried in at pole^1 through pole^4
+	const float pole_2 = pole * pole;
+
+	const __m128 p1 = _mm_set1_ps(pole);
+	const __m128 p2 = _mm_set1_ps(pole_2);
+	const __m128 carry_weights = _mm_setr_ps(pole, pole_2, pole_2 * pole, pole_2 * pole_2);
+
+	for (; n + 4 <= count; n += 4)
+	{
+		__m128 sum = _mm_loadu_ps(&data[n]);
+
+		sum = _mm_add_ps(sum, _mm_mul_ps(p1, _mm_castsi128_ps(_mm_slli_si128(_mm_castps_si128(sum), 4))));
+		sum = _mm_add_ps(sum, _mm_mul_ps(p2, _mm_castsi128_ps(_mm_slli_si128(_mm_castps_si128(sum), 8))));
+		sum = _mm_add_ps(sum, _mm_mul_ps(carry_weights, _mm_set1_ps(y)));
+
+		_mm_storeu_ps(&data[n], sum);
+		y = _mm_cvtss_f32(_mm_shuffle_ps(sum, sum, _MM_SHUFFLE(3, 3, 3, 3)));
+	}
+
+#endif
+
+	for (; n < count; ++n)
+	{
+		y = pole * y + data[n];
+		data[n] = y;
+	}
+}
+
+////////////////////
+// Resampler
+////////////////////
+
+float AudioChain::dot(const float *samples, const float *weights)
+{
+#if defined(__AVX2__)
+
+	static_assert(TAPS % 8 == 0);
+
+	__m256 sum = _mm256_setzero_ps();
+
+	for (size_t tap {}; tap < TAPS; tap += 8)
+		sum = _mm256_add_ps(sum, _mm256_mul_ps(_mm256_loadu_ps(samples + tap), _mm256_loadu_ps(weights + tap)));
+
+	__m128 half = _mm_add_ps(_mm256_castps256_ps128(sum), _mm256_extractf128_ps(sum, 1));
+
+	half = _mm_add_ps(half, _mm_movehl_ps(half, half));
+	half = _mm_add_ss(half, _mm_shuffle_ps(half, half, _MM_SHUFFLE(1, 1, 1, 1)));
+
+	return _mm_cvtss_f32(half);
+
+#elif defined(__SSE2__)
+
+	static_assert(TAPS % 4 == 0);
+
+	__m128 sum = _mm_setzero_ps();
+
+	for (size_t tap {}; tap < TAPS; tap += 4)
+		sum = _mm_add_ps(sum, _mm_mul_ps(_mm_loadu_ps(samples + tap), _mm_loadu_ps(weights + tap)));
+
+	sum = _mm_add_ps(sum, _mm_movehl_ps(sum, sum));
+	sum = _mm_add_ss(sum, _mm_shuffle_ps(sum, sum, _MM_SHUFFLE(1, 1, 1, 1)));
+
+	return _mm_cvtss_f32(sum);
+
+#else
+
+	float sum {};
+
+	for (size_t tap {}; tap < TAPS; ++tap)
+		sum += samples[tap] * weights[tap];
+
+	return sum;
+
+#endif
+}
\ No newline at end of file
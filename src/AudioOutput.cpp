@@ -0,0 +1,167 @@
+#include "AudioOutput.hpp"
+
+#include <algorithm>
+#include <iostream>
+
+AudioOutput::AudioOutput(double sample_rate_ref, size_t channels_ref, std::chrono::nanoseconds frame_period)
+	: sample_rate { sample_rate_ref }
+	, channels { channels_ref }
+{
+	SDL_AudioSpec wanted {};
+	SDL_AudioSpec obtained {};
+
+	wanted.freq = static_cast<int>(sample_rate);
+	wanted.format = AUDIO_F32SYS;
+	wanted.channels = static_cast<Uint8>(channels);
+	wanted.samples = 256;
+	wanted.callback = callback;
+	wanted.userdata = this;
+
+	// Resampling to the device's own rate is left to the audio chain, and
+	// any other conversion to SDL
+	device = SDL_OpenAudioDevice(nullptr, 0, &wanted, &obtained, SDL_AUDIO_ALLOW_FREQUENCY_CHANGE);
+
+	if (device == 0)
+	{
+		std::cerr << "No audio: " << SDL_GetError() << '\n';
+		return;
+	}
+
+	sample_rate = obtained.freq;
+	device_samples = obtained.samples;
+
+	// Wake a quarter frame above one device buffer, so the frame is made
+	// before the next callback needs it
+	const double frame_samples = std::chrono::duration<double>(frame_period).count() * sample_rate;
+
+	low_water = device_samples + static_cast<size_t>(frame_samples / 4);
+
+	// Callbacks take a device buffer at a time, so the pacer wakes on
+	// average half of one below the low water mark
+	fill_target = low_water - device_samples / 2.0;
+}
+
+AudioOutput::~AudioOutput()
+{
+	// Returns once the callback has finished for good
+	if (device != 0)
+		SDL_CloseAudioDevice(device);
+}
+
+bool AudioOutput::opened() const
+{
+	return device != 0;
+}
+
+double AudioOutput::rate() const
+{
+	return sample_rate;
+}
+
+////////////////////
+// Emulation thread
+////////////////////
+
+void AudioOutput::push(const float *samples, size_t count)
+{
+	if (device == 0)
+		return;
+
+	const size_t fill = ring.size() / channels;
+
+	// Make more samples while the queue is short and fewer while it is
+	// long, in proportion to the error
+	rate_ratio = std::clamp(
+		1.0 + MAX_DELTA * (fill_target - fill) / fill_target,
+		1.0 - MAX_DELTA,
+		1.0 + MAX_DELTA
+	);
+
+	// Whole sample frames only, so the sides never swap
+	const size_t room = (ring.capacity() - ring.size()) / channels * channels;
+	const size_t pushed = ring.push(samples, std::min(count, room));
+
+	if (pushed < count)
+	{
+		overruns++;
+		dropped += (count - pushed) / channels;
+	}
+
+	pushes++;
+	fill_sum += fill;
+	fill_max = std::max(fill_max, fill);
+	ratio_min = std::min(ratio_min, rate_ratio);
+	ratio_max = std::max(ratio_max, rate_ratio);
+
+	if (playing == false && ring.size() / channels >= low_water)
+	{
+		SDL_PauseAudioDevice(device, 0);
+		playing = true;
+	}
+}
+
+double AudioOutput::ratio() const
+{
+	return rate_ratio;
+}
+
+double AudioOutput::queued() const
+{
+	return ring.size() / channels / sample_rate;
+}
+
+double AudioOutput::target() const
+{
+	return low_water / sample_rate;
+}
+
+////////////////////
+// Callback thread
+////////////////////
+
+void AudioOutput::callback(void *userdata, Uint8 *stream, int length)
+{
+	AudioOutput& output = *static_cast<AudioOutput *>(userdata);
+
+	float *out = reinterpret_cast<float *>(stream);
+	const size_t count = length / sizeof(float);
+	const size_t popped = output.ring.pop(out, count);
+	const size_t channels = output.channels;
+
+	// Pushes are whole sample frames, so pops are too
+	if (popped > 0)
+		std::copy_n(out + popped - channels, channels, output.last.begin());
+
+	// Hold the last level rather than dropping to silence, which clicks
+	if (popped < count)
+	{
+		for (size_t i { popped }; i < count; ++i)
+			out[i] = output.last[i % channels];
+
+		output.underruns.fetch_add(1, std::memory_order_relaxed);
+		output.starved.fetch_add((count - popped) / channels, std::memory_order_relaxed);
+	}
+
+	output.callbacks.fetch_add(1, std::memory_order_relaxed);
+}
+
+////////////////////
+// Statistics
+////////////////////
+
+AudioOutput::AudioStats AudioOutput::stats() const
+{
+	const double ms = 1000.0 / sample_rate;
+
+	return {
+		callbacks.load(std::memory_order_relaxed),
+		underruns.load(std::memory_order_relaxed),
+		starved.load(std::memory_order_relaxed),
+		overruns,
+		dropped,
+		(pushes > 0) ? fill_sum / pushes * ms : 0,
+		fill_max * ms,
+		ratio_min,
+		ratio_max
+	};
+}
\ No newline at end of file
@@ -0,0 +1,181 @@
+#include "AudioWriter.hpp"
+
+#include <array>
+#include <iostream>
+#include <stdexcept>
+
+AudioWriter::AudioWriter(const std::string& path, Format format_ref, double sample_rate_ref, size_t channels_ref)
+	: format { format_ref }
+	, sample_rate { static_cast<uint32_t>(sample_rate_ref) }
+	, channels { static_cast<uint16_t>(channels_ref) }
+	, max_data_bytes { static_cast<uint32_t>((UINT32_MAX - HEADER_SIZE) / (channels * sizeof(float)) * (channels * sizeof(float))) }
+{
+	piped = path.starts_with('|');
+	stream = piped ? popen(path.c_str() + 1, "w") : std::fopen(path.c_str(), "wb");
+
+	if (stream == nullptr)
+		throw std::runtime_error("Error opening audio output\n");
+
+	if (format == Format::WAV)
+	{
+		writeHeader(max_data_bytes);
+		writer_stats.bytes += HEADER_SIZE;
+	}
+
+	writer = std::thread { &AudioWriter::write, this };
+}
+
+AudioWriter::~AudioWriter()
+{
+	finish();
+}
+
+void AudioWriter::finish()
+{
+	if (writer.joinable() == false)
+		return;
+
+	{
+		std::lock_guard<std::mutex> lock { mutex };
+		stopping = true;
+	}
+
+	queued.notify_one();
+	writer.join();
+
+	// Files get their real sizes once everything is written
+	if (format == Format::WAV && piped == false)
+	{
+		std::fseek(stream, 0, SEEK_SET);
+		// The writer never goes past max_data_bytes, so this cannot wrap
+		writeHeader(static_cast<uint32_t>(writer_stats.samples * sizeof(float)));
+	}
+
+	piped ? pclose(stream) : std::fclose(stream);
+	stream = nullptr;
+}
+
+void AudioWriter::submit(const float *samples, size_t count)
+{
+	if (count == 0)
+		return;
+
+	std::vector<float> block { samples, samples + count };
+
+	{
+		std::unique_lock<std::mutex> lock { mutex };
+
+		if (blocks.size() >= MAX_BLOCKS)
+		{
+			writer_stats.stalls++;
+			written.wait(lock, [this] { return blocks.size() < MAX_BLOCKS; });
+		}
+
+		blocks.push_back(std::move(block));
+	}
+
+	queued.notify_one();
+}
+
+AudioWriter::WriterStats AudioWriter::stats()
+{
+	std::lock_guard<std::mutex> lock { mutex };
+
+	return writer_stats;
+}
+
+////////////////////
+// Writer
+////////////////////
+
+void AudioWriter::write()
+{
+	while (true)
+	{
+		std::vector<float> block;
+
+		{
+			std::unique_lock<std::mutex> lock { mutex };
+
+			queued.wait(lock, [this] { return stopping == true || blocks.empty() == false; });
+
+			if (blocks.empty() == true)
+				return;
+
+			block = std::move(blocks.front());
+			blocks.pop_front();
+		}
+
+		written.notify_one();
+
+		// Past the limit the sizes would wrap and corrupt the file, so the
+		// rest of the run is only counted
+		size_t count = block.size();
+
+		if (format == Format::WAV)
+		{
+			const size_t room = (max_data_bytes - writer_stats.samples * sizeof(float)) / sizeof(float);
+
+			if (count > room)
+			{
+				if (writer_stats.dropped == 0)
+					std::cerr << "Audio output reached the WAVE size limit, stopping\n";
+
+				std::lock_guard<std::mutex> lock { mutex };
+
+				writer_stats.dropped += count - room;
+				count = room;
+			}
+		}
+
+		// float32 is little-endian on every host this builds for
+		const size_t bytes = std::fwrite(block.data(), sizeof(float), count, stream) * sizeof(float);
+
+		std::lock_guard<std::mutex> lock { mutex };
+
+		writer_stats.samples += count;
+		writer_stats.bytes += bytes;
+	}
+}
+
+void AudioWriter::writeHeader(uint32_t data_bytes)
+{
+	std::array<uint8_t, HEADER_SIZE> header {};
+	size_t at {};
+
+	const auto tag = [&](const char *text) {
+		for (size_t i {}; i < 4; ++i)
+			header[at++] = text[i];
+	};
+
+	const auto number = [&](uint32_t value, size_t size) {
+		for (size_t i {}; i < size; ++i)
+			header[at++] = static_cast<uint8_t>(value >> (8 * i));
+	};
+
+	const uint32_t frame_bytes = channels * sizeof(float);
+
+	tag("RIFF");
+	number(HEADER_SIZE - 8 + data_bytes, 4);
+	tag("WAVE");
+
+	// Non-PCM formats carry the extension size and a fact chunk
+	tag("fmt ");
+	number(18, 4);
+	number(3, 2); // IEEE float
+	number(channels, 2);
+	number(sample_rate, 4);
+	number(sample_rate * frame_bytes, 4);
+	number(frame_bytes, 2);
+	number(32, 2);
+	number(0, 2); // no extension
+
+	tag("fact");
+	number(4, 4);
+	number(data_bytes / frame_bytes, 4); // sample frames
+
+	tag("data");
+	number(data_bytes, 4);
+
+	std::fwrite(header.data(), 1, header.size(), stream);
+}
\ No newline at end of file
@@ -0,0 +1,203 @@
+#include "BandRenderer.hpp"
+
+#include <algorithm>
+
+BandRenderer::BandRenderer()
+{
+	// Leave a core for the emulation thread
+	const size_t cores = std::thread::hardware_concurrency();
+	band_count = std::clamp<size_t>((cores > 1) ? cores - 1 : 1, 1, 8);
+
+	for (size_t band {}; band < band_count; ++band)
+		workers.emplace_back(&BandRenderer::work, this, band);
+}
+
+BandRenderer::~BandRenderer()
+{
+	{
+		std::lock_guard<std::mutex> lock { mutex };
+		stopping = true;
+	}
+
+	work_ready.notify_all();
+
+	for (std::thread& worker : workers)
+		worker.join();
+}
+
+////////////////////
+// Frames
+////////////////////
+
+BandRenderer::Frame& BandRenderer::recording()
+{
+	return frames[recording_index];
+}
+
+void BandRenderer::submit()
+{
+	{
+		std::lock_guard<std::mutex> lock { mutex };
+
+		rendering_index = recording_index;
+		recording_index ^= 1;
+
+		job++;
+		remaining = band_count;
+		pending = true;
+	}
+
+	work_ready.notify_all();
+}
+
+bool BandRenderer::collect(uint8_t out[SCREEN_H][SCREEN_W], std::array<uint8_t, SCREEN_H>& emphasis)
+{
+	std::unique_lock<std::mutex> lock { mutex };
+
+	if (pending == false)
+		return false;
+
+	work_done.wait(lock, [this] { return remaining == 0; });
+
+	std::copy_n(&output[0][0], SCREEN_H * SCREEN_W, &out[0][0]);
+	emphasis = output_emphasis;
+	pending = false;
+
+	return true;
+}
+
+////////////////////
+// Workers
+////////////////////
+
+void BandRenderer::work(size_t band)
+{
+	size_t done {};
+
+	while (true)
+	{
+		const Frame *frame {};
+
+		{
+			std::unique_lock<std::mutex> lock { mutex };
+
+			work_ready.wait(lock, [&] { return stopping == true || job != done; });
+
+			if (stopping == true)
+				return;
+
+			done = job;
+			frame = &frames[rendering_index];
+		}
+
+		const size_t height = (SCREEN_H + band_count - 1) / band_count;
+		const size_t first = std::min(band * height, SCREEN_H);
+		const size_t last = std::min(first + height, SCREEN_H);
+
+		renderBand(*frame, first, last);
+
+		std::lock_guard<std::mutex> lock { mutex };
+
+		if (--remaining == 0)
+			work_done.notify_one();
+	}
+}
+
+void BandRenderer::renderBand(const Frame& frame, size_t first, size_t last)
+{
+	if (first == last)
+		return;
+
+	Memory memory = frame.start;
+
+	PPU::RenderSource source {};
+
+	for (size_t i {}; i < source.patterns.size(); ++i)
+		source.patterns[i] = &memory.patterns[i * 0x0400];
+
+	std::array<uint8_t, 32> colors {};
+	source.colors = colors.data();
+
+	size_t next {};
+
+	// Brings memory up to the given dot of the frame
+	const auto replay = [&](uint32_t dot) {
+		for (; next < frame.writes.size() && frame.writes[next].dot < dot; ++next)
+			applyWrite(memory, frame.writes[next]);
+	};
+
+	std::array<PPU::Sprite, 8> sprites {};
+	size_t sprite_count {};
+	bool overflow {};
+
+	uint8_t bg[SCREEN_W];
+	uint8_t fg[SCREEN_W];
+
+	// Sprites for a line are gathered at dot 257 of the line before it
+	if (first > 0)
+	{
+		replay((first - 1) * 341 + 257);
+
+		sprite_count = PPU::findSprites(
+			memory.OAM.data(), frame.lines[first - 1].ctrl, first, sprites.data(), overflow
+		);
+	}
+
+	for (size_t line { first }; line < last; ++line)
+	{
+		replay(line * 341 + 257);
+
+		// Mappers can switch mirroring mid-frame
+		for (size_t i {}; i < source.nametables.size(); ++i)
+			source.nametables[i] = &memory.nametables[memory.nametable_map[i]];
+
+		const PPU::LineState& state = frame.lines[line];
+
+		const uint8_t mask = (state.mask.greyscale == 1) ? 0x30 : 0x3F;
+
+		for (size_t i {}; i < colors.size(); ++i)
+			colors[i] = memory.palettes[i] & mask;
+
+		output_emphasis[line] = state.mask.val >> 5;
+
+		PPU::renderBackground(source, state, bg);
+
+		const bool visible = state.mask.show_fg == 1 && sprite_count > 0;
+
+		if (visible == true)
+			PPU::renderSprites(source, state, line, sprites.data(), sprite_count, fg);
+
+		PPU::mergeRow(bg, (visible == true) ? fg : nullptr, colors.data(), output[line]);
+
+		if (line + 1 < SCREEN_H)
+			sprite_count = PPU::findSprites(
+				memory.OAM.data(), state.ctrl, line + 1, sprites.data(), overflow
+			);
+	}
+}
+
+void BandRenderer::applyWrite(Memory& memory, const PPU::Write& write)
+{
+	switch (write.target)
+	{
+	case PPU::WriteTarget::Nametable:
+		memory.nametables[(write.addr >> 10) & 0x03][write.addr & 0x03FF] = write.data;
+		break;
+
+	case PPU::WriteTarget::NametableMap:
+		memory.nametable_map[write.addr & 0x03] = write.data;
+		break;
+
+	case PPU::WriteTarget::Pattern:
+		memory.patterns[write.addr & 0x1FFF] = write.data;
+		break;
+
+	case PPU::WriteTarget::Palette:
+		memory.palettes[write.addr & 0x1F] = write.data;
+		break;
+
+	case PPU::WriteTarget::OAM:
+		memory.OAM[write.addr & 0xFF] = write.data;
+		break;
+	}
+}
\ No newline at end of file
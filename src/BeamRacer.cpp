@@ -0,0 +1,55 @@
+#include "BeamRacer.hpp"
+
+#include "PPU.hpp"
+
+BeamRacer::BeamRacer(FramePacer& pacer_ref, const ScanoutClock& scanout_ref, size_t slice_count)
+	: slices { slice_count }
+	, pacer { &pacer_ref }
+	, scanout { &scanout_ref }
+{
+}
+
+void BeamRacer::beginFrame()
+{
+	next_slice = 0;
+	rows = 0;
+}
+
+bool BeamRacer::sliceReady(size_t rows_ready)
+{
+	if (next_slice >= slices || scanout->calibrated() == false)
+		return false;
+
+	const size_t slice_rows = (next_slice + 1) * SCREEN_H / slices;
+
+	if (rows_ready < slice_rows)
+		return false;
+
+	const size_t first_row = next_slice * SCREEN_H / slices;
+	const double top = static_cast<double>(first_row) / SCREEN_H;
+
+	const auto now = std::chrono::steady_clock::now();
+
+	// The first slice picks the refresh: the next one whose raster it can
+	// still beat. Later slices race the same raster further down
+	const auto after = (next_slice == 0) ? now + LEAD : raster;
+
+	raster = scanout->rowTime(top, after);
+
+	// A slice finished after its rows were scanned shows a tear; it goes
+	// out at once so the rest of the frame still makes this refresh
+	if (raster - LEAD < now)
+		race_stats.late++;
+	else
+		pacer->waitUntil(raster - LEAD);
+
+	next_slice++;
+	rows = slice_rows;
+
+	race_stats.slices++;
+
+	if (next_slice == slices)
+		race_stats.frames++;
+
+	return true;
+}
\ No newline at end of file
@@ -0,0 +1,185 @@
+#include "BlipBuffer.hpp"
+
+#include <algorithm>
+#include <cmath>
+#include <numbers>
+
+BlipBuffer::BlipBuffer(double clock_rate, double sample_rate, size_t capacity_ref)
+	: nominal { sample_rate / clock_rate }
+	, capacity { capacity_ref }
+{
+	setRatio(1.0);
+
+	// Room for a frame twice the capacity beyond what is kept, plus the
+	// kernel tail of its last step
+	buffer.resize(3 * capacity + MAX_TAPS);
+
+	buildKernel();
+}
+
+BlipBuffer::Quality BlipBuffer::next(Quality quality)
+{
+	switch (quality)
+	{
+	case Quality::Low:
+		return Quality::Medium;
+	case Quality::Medium:
+		return Quality::High;
+	case Quality::High:
+		return Quality::Low;
+	}
+
+	return Quality::Medium;
+}
+
+const char *BlipBuffer::name(Quality quality)
+{
+	switch (quality)
+	{
+	case Quality::Low:
+		return "low";
+	case Quality::Medium:
+		return "medium";
+	case Quality::High:
+		return "high";
+	}
+
+	return "";
+}
+
+void BlipBuffer::setQuality(Quality quality_ref)
+{
+	// Steps already in the buffer keep the kernel they were added with
+	quality = quality_ref;
+	buildKernel();
+}
+
+BlipBuffer::Quality BlipBuffer::getQuality() const
+{
+	return quality;
+}
+
+void BlipBuffer::setRatio(double ratio)
+{
+	// Deltas are placed from the start of their frame, so this is called
+	// between frames
+	factor = static_cast<uint64_t>(std::llround(nominal * ratio * 4294967296.0));
+}
+
+void BlipBuffer::buildKernel()
+{
+	switch (quality)
+	{
+	case Quality::Low:
+		taps = 8;
+		break;
+	case Quality::Medium:
+		taps = 16;
+		break;
+	case Quality::High:
+		taps = 32;
+		break;
+	}
+
+	kernel.assign(PHASES * taps, 0.0f);
+
+	// Cut off a little below Nyquist so the transition band stays inside it
+	constexpr double cutoff { 0.90 };
+	constexpr double pi { std::numbers::pi };
+
+	for (size_t phase {}; phase < PHASES; ++phase)
+	{
+		float *row = &kernel[phase * taps];
+		double sum {};
+
+		for (size_t tap {}; tap < taps; ++tap)
+		{
+			// Distance from the step, which sits phase / PHASES past the
+			// middle of the kernel
+			const double x = tap - (taps / 2.0 - 1) - static_cast<double>(phase) / PHASES;
+			const double sinc = (x == 0) ? 1.0 : std::sin(pi * cutoff * x) / (pi * cutoff * x);
+
+			// Blackman window over the kernel
+			const double w = 2 * pi * (x + taps / 2.0) / taps;
+			const double window = 0.42 - 0.5 * std::cos(w) + 0.08 * std::cos(2 * w);
+
+			row[tap] = static_cast<float>(sinc * window);
+			sum += row[tap];
+		}
+
+		// Every step must end exactly at its full height
+		for (size_t tap {}; tap < taps; ++tap)
+			row[tap] = static_cast<float>(row[tap] / sum);
+	}
+}
+
+////////////////////
+// Input
+////////////////////
+
+void BlipBuffer::addDelta(uint64_t time, float delta)
+{
+	const uint64_t position = time * factor + offset;
+
+	const size_t index = samples + static_cast<size_t>(position >> 32);
+	const size_t phase = static_cast<size_t>(position >> (32 - PHASE_BITS)) & (PHASES - 1);
+
+	if (index + taps > buffer.size())
+		return;
+
+	const float *row = &kernel[phase * taps];
+	float *out = &buffer[index];
+
+	for (size_t tap {}; tap < taps; ++tap)
+		out[tap] += delta * row[tap];
+}
+
+void BlipBuffer::endFrame(uint64_t time)
+{
+	offset += time * factor;
+
+	samples = std::min(samples + static_cast<size_t>(offset >> 32), buffer.size() - MAX_TAPS);
+	offset &= 0xFFFFFFFF;
+
+	// Nobody is reading: keep the newest capacity samples
+	if (samples > capacity)
+	{
+		const size_t excess = samples - capacity;
+
+		read(nullptr, excess);
+		discarded += excess;
+	}
+}
+
+////////////////////
+// Output
+////////////////////
+
+size_t BlipBuffer::available() const
+{
+	return samples;
+}
+
+size_t BlipBuffer::read(float *out, size_t count)
+{
+	count = std::min(count, samples);
+
+	for (size_t i {}; i < count; ++i)
+	{
+		integrator += buffer[i];
+
+		if (out != nullptr)
+			out[i] = integrator;
+	}
+
+	// Move what is left, including the tails of steps not yet complete and
+	// any steps already added to the frame in progress
+	const size_t remaining = buffer.size() - count;
+
+	std::copy_n(buffer.begin() + count, remaining, buffer.begin());
+	std::fill_n(buffer.begin() + remaining, count, 0.0f);
+
+	samples -= count;
+
+	return count;
+}
\ No newline at end of file
@@ -15,6 +15,11 @@ Bus::~Bus()
 // Devices
 ////////////////////
 
+void Bus::connectAPU(APU& apu_ref)
+{
+	apu = &apu_ref;
+}
+
 void Bus::connectCartridge(Cartridge& cart_ref)
 {
 	cartridge = &cart_ref;
@@ -28,23 +33,35 @@ void Bus::connectCPU(CPU& cpu_ref)
 void Bus::connectPPU(PPU& ppu_ref)
 {
 	ppu = &ppu_ref;
+	cartridge->connectPPU(ppu_ref);
 }
 
 ////////////////////
 // Timing
 ////////////////////
 
-void Bus::tick(uint8_t cycles)
+void Bus::tick(uint16_t cycles)
 {
 	cpu_cycles += cycles;
 	ppu->step(cycles * 3);
+
+	// The APU catches up on its own when it is next needed
+}
+
+bool Bus::irq() const
+{
+	// The cartridge's line is scheduled ahead in PPU cycles
+	if (ppu->dots >= cartridge->irq_dot)
+		return true;
+
+	return apu != nullptr && apu->irq() == true;
 }
 
 ////////////////////
 // Data access
 ////////////////////
 
-uint8_t Bus::cpuRead(uint16_t addr) const
+uint8_t Bus::cpuRead(uint16_t addr)
 {
 	uint8_t data {};
 
@@ -52,13 +69,21 @@ uint8_t Bus::cpuRead(uint16_t addr) const
 	{
 	// RAM
 	case 0x0000 ... 0x1FFF:
-		return RAM[addr % 0x2000];
+		return RAM[addr % 0x0800];
 
 	// PPU Registers
 	case 0x2000 ... 0x3FFF:
 		data = ppu->readRegister(addr % 8, false);
 		break;
 
+	// APU status
+	case 0x4015:
+		return (apu != nullptr) ? apu->readStatus(false) : 0;
+
+	// Controllers
+	case 0x4016 ... 0x4017:
+		return controllers[addr & 0x01].read(false);
+
 	// PRG ROM
 	case 0x4018 ... 0xFFFF:
 		return cartridge->readPRG(addr);
@@ -75,14 +100,64 @@ void Bus::cpuWrite(uint16_t addr, uint8_t data)
 	switch (addr)
 	{
 	case 0x0000 ... 0x1FFF:
-		RAM[addr % 0x2000] = data;
+		RAM[addr % 0x0800] = data;
 		break; // RAM
 	case 0x2000 ... 0x3FFF:
 		ppu->writeRegister(addr % 8, data);
 		break; // PPU Registers
+	case 0x4000 ... 0x4013:
+	case 0x4015:
+	case 0x4017:
+		if (apu != nullptr)
+			apu->writeRegister(addr, data);
+		break; // APU
+	case 0x4014:
+		oamDMA(data);
+		break; // OAM DMA
+	case 0x4016:
+		controllers[0].write(data);
+		controllers[1].write(data);
+		break; // Controller strobe
+	case 0x4018 ... 0xFFFF:
+		// DMC samples are read from PRG ROM; fetch those due before the
+		// banks move
+		if (addr >= 0x8000 && apu != nullptr)
+			apu->catchUp();
+
+		cartridge->writePRG(addr, data, cpu_cycles);
+		break; // PRG RAM and mapper registers
 	}
 }
 
+const uint8_t *Bus::cpuPage(uint8_t page) const
+{
+	// Pages backed by plain memory, readable without side effects
+	if (page < 0x20)
+		return &RAM[(page << 8) % 0x0800];
+
+	return nullptr;
+}
+
+void Bus::oamDMA(uint8_t page)
+{
+	const uint8_t *src = cpuPage(page);
+
+	std::array<uint8_t, 256> copy;
+
+	if (src == nullptr)
+	{
+		for (size_t i {}; i < copy.size(); ++i)
+			copy[i] = cpuRead((page << 8) | i);
+
+		src = copy.data();
+	}
+
+	ppu->writeOAM(src);
+
+	// The CPU halts for 513 cycles, plus one to align on an odd cycle
+	tick(513 + (cpu_cycles & 1));
+}
+
 uint8_t Bus::ppuRead(uint16_t addr) const
 {
 	switch (addr)
@@ -91,52 +166,15 @@ uint8_t Bus::ppuRead(uint16_t addr) const
 	case 0x0000 ... 0x1FFF:
 		return cartridge->readCHR(addr);
 
-	// Nametables (VRAM)
+	// Nametables (VRAM), $3000 - $3EFF mirrors $2000 - $2EFF
 	case 0x2000 ... 0x3EFF:
-	{
-		addr %= 0x2000;
-
-		switch (cartridge->mirroring)
-		{
-		case Cartridge::Mirroring::Horizontal:
-		{
-			if (addr >= 0x0000 && addr <= 0x03FF)
-				return ppu->nametable_0[addr % 0x0400];
-
-			if (addr >= 0x0400 && addr <= 0x07FF)
-				return ppu->nametable_1[addr % 0x0400];
-
-			if (addr >= 0x0800 && addr <= 0x1BFF)
-				return ppu->nametable_2[addr % 0x0400];
-
-			if (addr >= 0x1C00 && addr <= 0x1FFF)
-				return ppu->nametable_3[addr % 0x0400];
-		}
-		break;
-
-		case Cartridge::Mirroring::Vertical:
-		{
-			throw std::runtime_error(
-				"Error: vertical mirroring not implemented\n"
-			);
-			return 1;
-		}
-		break;
-
-		default:
-			return ppu->nametable_0[addr & 0x1000];
-		}
-	}
-	break;
+		return (*ppu->nametables[(addr >> 10) & 0x03])[addr & 0x03FF];
 
 	// Color Palettes
 	// $3F00 - $3F1F : palette indexes
 	// $3F20 - $3FFF : mirrors above
 	case 0x3F00 ... 0x3FFF:
-	{
-		uint8_t index = static_cast<uint8_t>(addr % 0x3F20);
-		return index;
-	}
+		return ppu->readPalette(addr);
 
 	// Mirrors $0000-$3FFF
 	case 0x4000 ... 0xFFFF:
@@ -151,54 +189,22 @@ void Bus::ppuWrite(uint16_t addr, uint8_t data)
 {
 	switch (addr)
 	{
-	// Cannot write to $0000 - $2000 (CHR ROM)?
+	// Pattern Tables (CHR RAM, ignored by CHR ROM)
 	case 0x0000 ... 0x1FFF:
+		cartridge->writeCHR(addr, data);
+		ppu->markPatternDirty(addr);
 		break;
 
-	// Nametables (VRAM)
+	// Nametables (VRAM), $3000 - $3EFF mirrors $2000 - $2EFF
 	case 0x2000 ... 0x3EFF:
-	{
-		addr %= 0x2000;
-
-		switch (cartridge->mirroring)
-		{
-		case Cartridge::Mirroring::Horizontal:
-		{
-			if (addr >= 0x0000 && addr <= 0x03FF)
-			{
-				ppu->nametable_0[addr] = data;
-			}
-
-			if (addr >= 0x0400 && addr <= 0x07FF)
-				ppu->nametable_1[addr % 0x0400] = data;
-
-			if (addr >= 0x0800 && addr <= 0x1BFF)
-				ppu->nametable_2[addr % 0x0800] = data;
-
-			if (addr >= 0x1C00 && addr <= 0x1FFF)
-				ppu->nametable_3[addr % 0x1C00] = data;
-		}
-		break;
-
-		case Cartridge::Mirroring::Vertical:
-		{
-			throw std::runtime_error(
-				"Error: vertical mirroring not implemented\n"
-			);
-		}
+		ppu->writeNametable((addr >> 10) & 0x03, addr, data);
 		break;
 
-		default:
-			ppu->nametable_0[addr & 0x1000] = data;
-		}
-	}
-	break;
-
 	// Color Palettes
 	// $3F00 - $3F1F : palette indexes
 	// $3F20 - $3FFF : mirrors above
 	case 0x3F00 ... 0x3FFF:
-		ppu->vram_palettes[addr - 0x3F00] = data;
+		ppu->writePalette(addr, data);
 		break;
 
 	// Mirrors $0000-$3FFF
@@ -19,6 +19,11 @@ void CPU::step()
 	current_cycles = 0;
 	additional_cycles = 0;
 
+	// IRQ is level triggered: taken before any instruction while a source
+	// holds the line and interrupts are enabled
+	if (bus->irq() == true && getFlag(Flag::I) == 0)
+		handleInterrupt(Interrupt::IRQ);
+
 	// Fetch
 	uint8_t opcode = fetchByte();
 
@@ -108,12 +113,27 @@ void CPU::write(uint16_t addr, uint8_t data)
 	bus->cpuWrite(addr, data);
 }
 
+void CPU::modify(uint16_t addr, uint8_t data, uint8_t result)
+{
+	// Read-modify-write instructions store the unmodified value a cycle
+	// before the result. RAM can't tell; registers and mappers can.
+	if (addr >= 0x2000)
+		write(addr, data);
+
+	write(addr, result);
+}
+
 ////////////////////
 // Helpers
 ////////////////////
 
 uint8_t CPU::fetchByte()
 {
+	// Code nearly always runs from PRG ROM, whose mapper read inlines here
+	// without the bus's address decoding
+	if (PC >= 0x8000)
+		return bus->cartridge->readPRG(PC++);
+
 	return read(PC++);
 }
 
@@ -658,13 +678,13 @@ void CPU::executeInstruction(
 		{
 			uint16_t addr = fetchOperandAddress(mode);
 			uint8_t data = read(addr);
+			uint8_t result = data << 1;
 
 			setFlag(Flag::C, data & 0b10000000);
-			data <<= 1;
-			setFlag(Flag::N, data & 0b10000000);
-			setFlag(Flag::Z, data == 0);
+			setFlag(Flag::N, result & 0b10000000);
+			setFlag(Flag::Z, result == 0);
 
-			write(addr, data);
+			modify(addr, data, result);
 		}
 	}
 	break;
@@ -822,7 +842,7 @@ void CPU::executeInstruction(
 		uint16_t addr = fetchOperandAddress(mode);
 		uint8_t data = read(addr);
 		uint8_t result = data - 1;
-		write(addr, result);
+		modify(addr, data, result);
 
 		setFlag(Flag::Z, result == 0);
 		setFlag(Flag::N, result & 0b10000000);
@@ -862,7 +882,7 @@ void CPU::executeInstruction(
 		uint8_t data = read(addr);
 		uint8_t result = data + 1;
 
-		write(addr, result);
+		modify(addr, data, result);
 
 		setFlag(Flag::Z, result == 0);
 		setFlag(Flag::N, result & 0b10000000);
@@ -946,8 +966,8 @@ void CPU::executeInstruction(
 			uint16_t addr = fetchOperandAddress(mode);
 			uint8_t data = read(addr);
 			setFlag(Flag::C, data & 0b00000001);
-			result = data >>= 1;
-			write(addr, result);
+			result = data >> 1;
+			modify(addr, data, result);
 		}
 
 		setFlag(Flag::N, 0);
@@ -1016,7 +1036,7 @@ void CPU::executeInstruction(
 			uint8_t data = read(addr);
 			input = data;
 			result = std::rotl(data, 1);
-			write(addr, result);
+			modify(addr, data, result);
 		}
 
 		setFlag(Flag::C, input & 0b10000000);
@@ -1056,7 +1076,7 @@ void CPU::executeInstruction(
 
 			setFlag(Flag::C, input & 0b00000001);
 			result = data;
-			write(addr, result);
+			modify(addr, input, result);
 		}
 
 		setFlag(Flag::Z, result == 0);
@@ -0,0 +1,347 @@
+#include "Capture.hpp"
+
+#include <algorithm>
+#include <stdexcept>
+
+#include <zlib.h>
+
+Capture::Capture(
+	const std::string& path_ref,
+	Format format_ref,
+	const uint32_t *colors_ref,
+	std::chrono::nanoseconds frame_period,
+	Overflow overflow_ref
+)
+	: path { path_ref }
+	, format { format_ref }
+	, colors { colors_ref }
+	, overflow { overflow_ref }
+{
+	if (format != Format::PNG)
+	{
+		piped = path.starts_with('|');
+		stream = piped ? popen(path.c_str() + 1, "w") : std::fopen(path.c_str(), "wb");
+
+		if (stream == nullptr)
+			throw std::runtime_error("Error opening capture output\n");
+	}
+
+	if (format == Format::Y4M)
+	{
+		// NES pixels are 8:7 on an NTSC television
+		const std::string header = "YUV4MPEG2 W" + std::to_string(SCREEN_W)
+			+ " H" + std::to_string(SCREEN_H)
+			+ " F1000000000:" + std::to_string(frame_period.count())
+			+ " Ip A8:7 C444\n";
+
+		std::fwrite(header.data(), 1, header.size(), stream);
+	}
+
+	// Leave a core for the emulation thread
+	const size_t cores = std::thread::hardware_concurrency();
+	const size_t encoder_count = std::clamp<size_t>((cores > 1) ? cores - 1 : 1, 1, 4);
+
+	for (size_t i {}; i < encoder_count; ++i)
+		encoders.emplace_back(&Capture::encode, this);
+
+	writer = std::thread { &Capture::write, this };
+}
+
+Capture::~Capture()
+{
+	finish();
+}
+
+void Capture::finish()
+{
+	if (writer.joinable() == false)
+		return;
+
+	{
+		std::lock_guard<std::mutex> lock { mutex };
+		stopping = true;
+	}
+
+	// Frames already queued are still encoded and written
+	work_ready.notify_all();
+
+	for (std::thread& encoder : encoders)
+		encoder.join();
+
+	encoded.notify_all();
+	writer.join();
+
+	if (stream != nullptr)
+		piped ? pclose(stream) : std::fclose(stream);
+
+	stream = nullptr;
+}
+
+bool Capture::submit(const uint8_t pixels[SCREEN_H][SCREEN_W], const std::array<uint8_t, SCREEN_H>& emphasis)
+{
+	Slot *slot {};
+
+	{
+		std::unique_lock<std::mutex> lock { mutex };
+
+		slot = &slots[next_submit % SLOTS];
+
+		if (slot->state != State::Free && overflow == Overflow::Wait)
+		{
+			capture_stats.stalls++;
+			freed.wait(lock, [slot] { return slot->state == State::Free; });
+		}
+
+		if (slot->state != State::Free)
+		{
+			capture_stats.dropped++;
+			return false;
+		}
+	}
+
+	// Only the writer frees a slot and only this thread fills it, so it can
+	// be copied without holding the lock
+	std::copy_n(&pixels[0][0], SCREEN_H * SCREEN_W, &slot->pixels[0][0]);
+	slot->emphasis = emphasis;
+
+	{
+		std::lock_guard<std::mutex> lock { mutex };
+
+		slot->number = next_submit++;
+		slot->state = State::Queued;
+	}
+
+	work_ready.notify_one();
+
+	return true;
+}
+
+Capture::CaptureStats Capture::stats()
+{
+	std::lock_guard<std::mutex> lock { mutex };
+
+	return capture_stats;
+}
+
+////////////////////
+// Workers
+////////////////////
+
+void Capture::encode()
+{
+	while (true)
+	{
+		Slot *slot {};
+
+		{
+			std::unique_lock<std::mutex> lock { mutex };
+
+			work_ready.wait(lock, [this] { return stopping == true || next_encode != next_submit; });
+
+			if (next_encode == next_submit)
+				return;
+
+			slot = &slots[next_encode++ % SLOTS];
+			slot->state = State::Encoding;
+		}
+
+		const auto start = std::chrono::steady_clock::now();
+
+		slot->encoded.clear();
+
+		switch (format)
+		{
+		case Format::Y4M:
+			encodeY4M(*slot, slot->encoded);
+			break;
+		case Format::Raw:
+			encodeRaw(*slot, slot->encoded);
+			break;
+		case Format::PNG:
+			encodePNG(*slot, slot->encoded);
+			break;
+		}
+
+		const std::chrono::duration<double, std::micro> elapsed =
+			std::chrono::steady_clock::now() - start;
+
+		{
+			std::lock_guard<std::mutex> lock { mutex };
+
+			slot->state = State::Encoded;
+			capture_stats.encode_us += elapsed.count();
+		}
+
+		encoded.notify_one();
+	}
+}
+
+void Capture::write()
+{
+	while (true)
+	{
+		Slot *slot {};
+
+		{
+			std::unique_lock<std::mutex> lock { mutex };
+
+			// Frames finish encoding out of order but are written in order
+			encoded.wait(lock, [this] {
+				return slots[next_write % SLOTS].state == State::Encoded
+					|| (stopping == true && next_write == next_submit);
+			});
+
+			if (slots[next_write % SLOTS].state != State::Encoded)
+				return;
+
+			slot = &slots[next_write % SLOTS];
+		}
+
+		if (format == Format::PNG)
+		{
+			char number[16];
+			std::snprintf(number, sizeof(number), "%06zu", slot->number);
+
+			const std::string name = path + number + ".png";
+
+			if (FILE *file = std::fopen(name.c_str(), "wb"))
+			{
+				std::fwrite(slot->encoded.data(), 1, slot->encoded.size(), file);
+				std::fclose(file);
+			}
+		} else
+		{
+			std::fwrite(slot->encoded.data(), 1, slot->encoded.size(), stream);
+		}
+
+		{
+			std::lock_guard<std::mutex> lock { mutex };
+
+			capture_stats.frames++;
+			capture_stats.bytes += slot->encoded.size();
+
+			slot->state = State::Free;
+			next_write++;
+		}
+
+		freed.notify_one();
+	}
+}
+
+////////////////////
+// Formats
+////////////////////
+
+void Capture::resolve(const Slot& slot, size_t Y, uint8_t *rgb) const
+{
+	const uint32_t *palette = colors + ((slot.emphasis[Y] & 0x07) << 6);
+
+	for (size_t X {}; X < SCREEN_W; ++X)
+	{
+		const uint32_t argb = palette[slot.pixels[Y][X] & 0x3F];
+
+		rgb[3 * X] = (argb >> 16) & 0xFF;
+		rgb[3 * X + 1] = (argb >> 8) & 0xFF;
+		rgb[3 * X + 2] = argb & 0xFF;
+	}
+}
+
+void Capture::encodeY4M(const Slot& slot, std::vector<uint8_t>& out) const
+{
+	constexpr char marker[] { "FRAME\n" };
+	constexpr size_t plane { SCREEN_W * SCREEN_H };
+
+	out.resize(sizeof(marker) - 1 + 3 * plane);
+	std::copy_n(marker, sizeof(marker) - 1, out.begin());
+
+	uint8_t *Y_plane = out.data() + sizeof(marker) - 1;
+	uint8_t *U_plane = Y_plane + plane;
+	uint8_t *V_plane = U_plane + plane;
+
+	uint8_t rgb[3 * SCREEN_W];
+
+	for (size_t Y {}; Y < SCREEN_H; ++Y)
+	{
+		resolve(slot, Y, rgb);
+
+		// BT.601, studio range
+		for (size_t X {}; X < SCREEN_W; ++X)
+		{
+			const int R = rgb[3 * X];
+			const int G = rgb[3 * X + 1];
+			const int B = rgb[3 * X + 2];
+
+			const size_t at = Y * SCREEN_W + X;
+
+			Y_plane[at] = static_cast<uint8_t>(((66 * R + 129 * G + 25 * B + 128) >> 8) + 16);
+			U_plane[at] = static_cast<uint8_t>(((-38 * R - 74 * G + 112 * B + 128) >> 8) + 128);
+			V_plane[at] = static_cast<uint8_t>(((112 * R - 94 * G - 18 * B + 128) >> 8) + 128);
+		}
+	}
+}
+
+void Capture::encodeRaw(const Slot& slot, std::vector<uint8_t>& out) const
+{
+	out.resize(3 * SCREEN_W * SCREEN_H);
+
+	for (size_t Y {}; Y < SCREEN_H; ++Y)
+		resolve(slot, Y, &out[3 * SCREEN_W * Y]);
+}
+
+void Capture::encodePNG(const Slot& slot, std::vector<uint8_t>& out) const
+{
+	constexpr size_t stride { 1 + 3 * SCREEN_W };
+
+	// Every row is stored with the Sub filter, the difference from the
+	// pixel to its left, which turns runs of one color into runs of zeros
+	std::vector<uint8_t> rows(stride * SCREEN_H);
+	uint8_t rgb[3 * SCREEN_W];
+
+	for (size_t Y {}; Y < SCREEN_H; ++Y)
+	{
+		resolve(slot, Y, rgb);
+
+		uint8_t *row = &rows[stride * Y];
+		row[0] = 1;
+
+		for (size_t i {}; i < 3 * SCREEN_W; ++i)
+			row[1 + i] = rgb[i] - ((i >= 3) ? rgb[i - 3] : 0);
+	}
+
+	uLongf size = compressBound(rows.size());
+	std::vector<uint8_t> compressed(size);
+	compress2(compressed.data(), &size, rows.data(), rows.size(), 6);
+
+	constexpr uint8_t signature[] { 0x89, 'P', 'N', 'G', '\r', '\n', 0x1A, '\n' };
+	out.assign(std::begin(signature), std::end(signature));
+
+	// Width, height, 8 bits per channel, RGB, deflate, no interlacing
+	const uint8_t header[13] {
+		0, 0, SCREEN_W >> 8, SCREEN_W & 0xFF,
+		0, 0, SCREEN_H >> 8, SCREEN_H & 0xFF,
+		8, 2, 0, 0, 0
+	};
+
+	appendChunk(out, "IHDR", header, sizeof(header));
+	appendChunk(out, "IDAT", compressed.data(), size);
+	appendChunk(out, "IEND", nullptr, 0);
+}
+
+void Capture::appendChunk(std::vector<uint8_t>& out, const char *type, const uint8_t *data, size_t size)
+{
+	const auto append32 = [&](uint32_t value) {
+		out.push_back(value >> 24);
+		out.push_back((value >> 16) & 0xFF);
+		out.push_back((value >> 8) & 0xFF);
+		out.push_back(value & 0xFF);
+	};
+
+	append32(static_cast<uint32_t>(size));
+
+	const size_t start = out.size();
+
+	out.insert(out.end(), type, type + 4);
+	out.insert(out.end(), data, data + size);
+
+	append32(crc32(0, &out[start], static_cast<uInt>(out.size() - start)));
+}
\ No newline at end of file
@@ -1,5 +1,7 @@
 #include "Cartridge.hpp"
 
+#include "PPU.hpp"
+
 Cartridge::Cartridge()
 {
 }
@@ -64,17 +66,7 @@ void Cartridge::loadROM(const std::string& rom_file)
 		uint8_t mapper_low = header.flags_6.mapper_low;
 		uint8_t mapper_high = header.flags_7.mapper_high;
 
-		mapper_id = (mapper_high << 4) & mapper_low;
-
-		switch (mapper_id)
-		{
-		case 0:
-			mapper = std::make_unique<Mapper000>(this);
-			break;
-
-		default:
-			std::cerr << "Invalid mapper ID!\n";
-		}
+		mapper_id = (mapper_high << 4) | mapper_low;
 
 		////////////////////
 		// PRG RAM
@@ -89,6 +81,54 @@ void Cartridge::loadROM(const std::string& rom_file)
 		ifs.read(reinterpret_cast<char *>(PRG_ROM.data()), PRG_ROM.size());
 		ifs.read(reinterpret_cast<char *>(CHR_ROM.data()), CHR_ROM.size());
 
+		if (chr_banks == 0)
+		{
+			chr_ram = true;
+			CHR_ROM.resize(CHR_BANK_SIZE);
+		}
+
+		if (PRG_ROM.empty() == true)
+		{
+			std::cerr << "ROM has no PRG data!\n";
+			return;
+		}
+
+		// Mappers keep pointers into the ROM, so they come last
+		switch (mapper_id)
+		{
+		case 0:
+			mapper.emplace<Mapper000>(this);
+			break;
+
+		case 1:
+			mapper.emplace<Mapper001>(this);
+			break;
+
+		case 2:
+			mapper.emplace<Mapper002>(this);
+			break;
+
+		case 3:
+			mapper.emplace<Mapper003>(this);
+			break;
+
+		case 4:
+			mapper.emplace<Mapper004>(this);
+			break;
+
+		case 7:
+			mapper.emplace<Mapper007>(this);
+			break;
+
+		default:
+			std::cerr << "Invalid mapper ID!\n";
+		}
+
+		banks = std::visit(Overloaded {
+			[](std::monostate) -> Mapper * { return nullptr; },
+			[](Mapper& loaded) { return &loaded; }
+		}, mapper);
+
 		ifs.close();
 	} else
 	{
@@ -124,6 +164,10 @@ void Cartridge::printHeader() const
 		std::cout << "Horizontal\n";
 	if (mirroring == Mirroring::Vertical)
 		std::cout << "Vertical\n";
+	if (mirroring == Mirroring::SingleScreenLow)
+		std::cout << "Single Screen (low)\n";
+	if (mirroring == Mirroring::SingleScreenHigh)
+		std::cout << "Single Screen (high)\n";
 	if (mirroring == Mirroring::FourScreen)
 		std::cout << "Four Screen\n";
 	std::cout << "Battery:   " << std::boolalpha << battery_backed << '\n';
@@ -162,15 +206,29 @@ void Cartridge::logROM(const std::string& log_file) const
 }
 
 ////////////////////
-// Data access
+// Mirroring
 ////////////////////
 
-uint8_t Cartridge::readPRG(uint16_t addr) const
+void Cartridge::setMirroring(Mirroring mode)
+{
+	// Every row redraws when the nametables move
+	if (mode == mirroring)
+		return;
+
+	mirroring = mode;
+
+	if (ppu != nullptr)
+		ppu->setMirroring(mode);
+}
+
+void Cartridge::chrPageSwitched(size_t page)
 {
-	return mapper->readPRG(addr);
+	if (ppu != nullptr)
+		ppu->markPatternPageDirty(page);
 }
 
-uint8_t Cartridge::readCHR(uint16_t addr) const
+void Cartridge::connectPPU(PPU& ppu_ref)
 {
-	return mapper->readCHR(addr);
+	ppu = &ppu_ref;
+	ppu->setMirroring(mirroring);
 }
\ No newline at end of file
@@ -0,0 +1,48 @@
+#include "Controller.hpp"
+
+////////////////////
+// Host
+////////////////////
+
+void Controller::press(uint8_t pressed_buttons, bool pressed)
+{
+	if (pressed == true)
+		held.fetch_or(pressed_buttons, std::memory_order_relaxed);
+	else
+		held.fetch_and(~pressed_buttons, std::memory_order_relaxed);
+}
+
+void Controller::sample()
+{
+	buttons = held.load(std::memory_order_relaxed);
+
+	if (strobe == true)
+		shift = buttons;
+}
+
+////////////////////
+// Data access
+////////////////////
+
+void Controller::write(uint8_t data)
+{
+	// While the strobe is high the register keeps reloading
+	strobe = data & 0x01;
+
+	if (strobe == true)
+		shift = buttons;
+}
+
+uint8_t Controller::read(bool read_only)
+{
+	// The upper bits are open bus, usually the $40 of the address
+	const uint8_t data = 0x40 | (shift & 0x01);
+
+	if (read_only == true || strobe == true)
+		return data;
+
+	// Reads past the eighth button return 1
+	shift = (shift >> 1) | 0x80;
+
+	return data;
+}
\ No newline at end of file
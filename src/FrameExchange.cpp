@@ -0,0 +1,35 @@
+#include "FrameExchange.hpp"
+
+////////////////////
+// Producer
+////////////////////
+
+FrameExchange::Frame& FrameExchange::back()
+{
+	return frames[back_index];
+}
+
+void FrameExchange::publish()
+{
+	const uint8_t previous = middle.exchange(back_index | FRESH, std::memory_order_acq_rel);
+
+	back_index = previous & ~FRESH;
+	published++;
+
+	if (previous & FRESH)
+		dropped++;
+}
+
+////////////////////
+// Consumer
+////////////////////
+
+const FrameExchange::Frame *FrameExchange::acquire()
+{
+	if ((middle.load(std::memory_order_relaxed) & FRESH) == 0)
+		return nullptr;
+
+	front_index = middle.exchange(front_index, std::memory_order_acq_rel) & ~FRESH;
+
+	return &frames[front_index];
+}
\ No newline at end of file
@@ -0,0 +1,150 @@
+#include "FrameHash.hpp"
+
+#include <bit>
+#include <cstring>
+#include <stdexcept>
+
+FrameHash::FrameHash(const std::string& path)
+	: log { path, std::ios::binary }
+{
+	if (log.is_open() == false)
+		throw std::runtime_error("Error opening frame hash log\n");
+
+	log.write(MAGIC, sizeof(MAGIC));
+}
+
+void FrameHash::record(const uint8_t buffer[SCREEN_H][SCREEN_W], const std::array<uint8_t, SCREEN_H>& emphasis)
+{
+	const uint64_t hash = frame(buffer, emphasis);
+
+	char bytes[8];
+
+	for (size_t i {}; i < 8; ++i)
+		bytes[i] = static_cast<char>(hash >> (8 * i));
+
+	log.write(bytes, sizeof(bytes));
+	frames++;
+}
+
+////////////////////
+// Hashing
+////////////////////
+
+uint64_t FrameHash::xxh64(const uint8_t *data, size_t size, uint64_t seed)
+{
+	constexpr uint64_t P1 { 0x9E3779B185EBCA87 };
+	constexpr uint64_t P2 { 0xC2B2AE3D27D4EB4F };
+	constexpr uint64_t P3 { 0x165667B19E3779F9 };
+	constexpr uint64_t P4 { 0x85EBCA77C2B2AE63 };
+	constexpr uint64_t P5 { 0x27D4EB2F165667C5 };
+
+	const auto read64 = [](const uint8_t *p) {
+		uint64_t value;
+		std::memcpy(&value, p, sizeof(value));
+		return value;
+	};
+
+	const auto read32 = [](const uint8_t *p) {
+		uint32_t value;
+		std::memcpy(&value, p, sizeof(value));
+		return value;
+	};
+
+	const auto round = [](uint64_t acc, uint64_t input) {
+		return std::rotl(acc + input * P2, 31) * P1;
+	};
+
+	const auto merge = [&](uint64_t acc, uint64_t lane) {
+		return (acc ^ round(0, lane)) * P1 + P4;
+	};
+
+	const uint8_t *p = data;
+	const uint8_t *end = data + size;
+
+	uint64_t hash;
+
+	if (size >= 32)
+	{
+		// Four independent lanes keep the multipliers busy every cycle
+		uint64_t v1 = seed + P1 + P2;
+		uint64_t v2 = seed + P2;
+		uint64_t v3 = seed;
+		uint64_t v4 = seed - P1;
+
+		for (; p + 32 <= end; p += 32)
+		{
+			v1 = round(v1, read64(p));
+			v2 = round(v2, read64(p + 8));
+			v3 = round(v3, read64(p + 16));
+			v4 = round(v4, read64(p + 24));
+		}
+
+		hash = std::rotl(v1, 1) + std::rotl(v2, 7) + std::rotl(v3, 12) + std::rotl(v4, 18);
+		hash = merge(hash, v1);
+		hash = merge(hash, v2);
+		hash = merge(hash, v3);
+		hash = merge(hash, v4);
+	} else
+	{
+		hash = seed + P5;
+	}
+
+	hash += size;
+
+	for (; p + 8 <= end; p += 8)
+		hash = std::rotl(hash ^ round(0, read64(p)), 27) * P1 + P4;
+
+	if (p + 4 <= end)
+	{
+		hash = std::rotl(hash ^ (read32(p) * P1), 23) * P2 + P3;
+		p += 4;
+	}
+
+	for (; p < end; ++p)
+		hash = std::rotl(hash ^ (*p * P5), 11) * P1;
+
+	hash ^= hash >> 33;
+	hash *= P2;
+	hash ^= hash >> 29;
+	hash *= P3;
+	hash ^= hash >> 32;
+
+	return hash;
+}
+
+uint64_t FrameHash::frame(const uint8_t buffer[SCREEN_H][SCREEN_W], const std::array<uint8_t, SCREEN_H>& emphasis)
+{
+	const uint64_t pixels = xxh64(&buffer[0][0], SCREEN_H * SCREEN_W);
+
+	return xxh64(emphasis.data(), emphasis.size(), pixels);
+}
+
+////////////////////
+// Logs
+////////////////////
+
+std::vector<uint64_t> FrameHash::load(const std::string& path)
+{
+	std::ifstream file { path, std::ios::binary };
+	std::vector<uint64_t> hashes;
+
+	char magic[sizeof(MAGIC)] {};
+	file.read(magic, sizeof(magic));
+
+	if (file.gcount() != sizeof(magic) || std::memcmp(magic, MAGIC, sizeof(MAGIC)) != 0)
+		return hashes;
+
+	uint8_t bytes[8];
+
+	while (file.read(reinterpret_cast<char *>(bytes), sizeof(bytes)))
+	{
+		uint64_t hash {};
+
+		for (size_t i {}; i < 8; ++i)
+			hash |= static_cast<uint64_t>(bytes[i]) << (8 * i);
+
+		hashes.push_back(hash);
+	}
+
+	return hashes;
+}
\ No newline at end of file
@@ -0,0 +1,168 @@
+#include "FramePacer.hpp"
+
+#include <algorithm>
+#include <cerrno>
+#include <cmath>
+#include <thread>
+
+#ifdef __linux__
+#include <time.h>
+#endif
+
+FramePacer::FramePacer(Region video_region, Sync sync_mode)
+	: region { video_region }
+	, sync { sync_mode }
+{
+}
+
+std::chrono::nanoseconds FramePacer::period() const
+{
+	return (region == Region::PAL) ? PAL_FRAME : NTSC_FRAME;
+}
+
+void FramePacer::wait(size_t speed)
+{
+	const std::chrono::nanoseconds frame = period() / std::max<size_t>(speed, 1);
+
+	// The audio device only paces real time; faster speeds fall back to
+	// the timer
+	if (sync == Sync::Audio && speed <= 1 && audio_queued != nullptr)
+	{
+		waitAudio(frame);
+	} else
+	{
+		waitTimer(frame);
+	}
+
+	record(frame);
+}
+
+void FramePacer::reset()
+{
+	deadline = {};
+	last_frame = {};
+}
+
+FramePacer::JitterStats FramePacer::jitter() const
+{
+	if (measured == 0)
+		return { frames, late, 0, 0, 0 };
+
+	return {
+		frames,
+		late,
+		jitter_sum / measured,
+		std::sqrt(jitter_squares / measured),
+		jitter_max
+	};
+}
+
+////////////////////
+// Waiting
+////////////////////
+
+void FramePacer::sleepUntil(Clock::time_point until)
+{
+#ifdef __linux__
+
+	// steady_clock is CLOCK_MONOTONIC here, so its epoch can be handed to
+	// the kernel as an absolute deadline
+	const auto since_epoch = until.time_since_epoch();
+	const auto seconds = std::chrono::duration_cast<std::chrono::seconds>(since_epoch);
+
+	timespec ts {};
+	ts.tv_sec = seconds.count();
+	ts.tv_nsec = std::chrono::duration_cast<std::chrono::nanoseconds>(since_epoch - seconds).count();
+
+	while (clock_nanosleep(CLOCK_MONOTONIC, TIMER_ABSTIME, &ts, nullptr) == EINTR)
+		;
+
+#else
+
+	std::this_thread::sleep_until(until);
+
+#endif
+}
+
+void FramePacer::waitTimer(std::chrono::nanoseconds frame)
+{
+	const Clock::time_point now = Clock::now();
+
+	if (deadline == Clock::time_point {})
+		deadline = now;
+
+	deadline += frame;
+
+	if (now >= deadline)
+	{
+		late++;
+
+		if (now - deadline > MAX_LAG * frame)
+			deadline = now;
+
+		return;
+	}
+
+	waitUntil(deadline);
+}
+
+void FramePacer::waitUntil(std::chrono::steady_clock::time_point until)
+{
+	const Clock::time_point wake = until - spin_margin;
+
+	if (Clock::now() < wake)
+	{
+		sleepUntil(wake);
+
+		// Move the margin towards twice the oversleep just seen
+		const auto oversleep = Clock::now() - wake;
+
+		spin_margin = std::clamp<std::chrono::nanoseconds>(
+			(spin_margin * 7 + oversleep * 2) / 8,
+			MIN_MARGIN,
+			MAX_MARGIN
+		);
+	}
+
+	while (Clock::now() < until)
+		std::this_thread::yield();
+}
+
+void FramePacer::waitAudio(std::chrono::nanoseconds frame)
+{
+	deadline = {};
+
+	// The device drains the queue in real time, so sleep off the excess
+	for (double queued = audio_queued(); queued > audio_target; queued = audio_queued())
+	{
+		const std::chrono::duration<double> excess { queued - audio_target };
+
+		sleepUntil(Clock::now() + std::min<std::chrono::nanoseconds>(
+			std::chrono::duration_cast<std::chrono::nanoseconds>(excess),
+			frame
+		));
+	}
+}
+
+////////////////////
+// Statistics
+////////////////////
+
+void FramePacer::record(std::chrono::nanoseconds frame)
+{
+	const Clock::time_point now = Clock::now();
+
+	if (last_frame != Clock::time_point {})
+	{
+		const std::chrono::duration<double, std::micro> error = (now - last_frame) - frame;
+		const double jitter = std::abs(error.count());
+
+		jitter_sum += jitter;
+		jitter_squares += jitter * jitter;
+		jitter_max = std::max(jitter_max, jitter);
+		measured++;
+	}
+
+	last_frame = now;
+	frames++;
+}
\ No newline at end of file
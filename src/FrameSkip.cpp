@@ -0,0 +1,77 @@
+#include "FrameSkip.hpp"
+
+FrameSkip::FrameSkip(Mode skip_mode, size_t skip_frames, std::chrono::nanoseconds frame_period)
+	: period { frame_period }
+{
+	setMode(skip_mode, skip_frames);
+}
+
+void FrameSkip::setMode(Mode skip_mode, size_t skip_frames)
+{
+	mode = skip_mode;
+	frames = skip_frames;
+	counter = 0;
+	deadline = {};
+	run = 0;
+}
+
+FrameSkip::Mode FrameSkip::getMode() const
+{
+	return mode;
+}
+
+size_t FrameSkip::getFrames() const
+{
+	return frames;
+}
+
+bool FrameSkip::next()
+{
+	switch (mode)
+	{
+	case Mode::Off:
+		return false;
+
+	case Mode::Fixed:
+		counter = (counter + 1) % (frames + 1);
+		return counter != 0;
+
+	case Mode::Adaptive:
+	{
+		const auto now = std::chrono::steady_clock::now();
+
+		if (deadline == std::chrono::steady_clock::time_point {})
+			deadline = now;
+
+		deadline += period;
+
+		// Late once the host is a whole frame behind, so the jitter of a
+		// paced frame never counts
+		if (now > deadline + period && run < MAX_SKIP)
+		{
+			run++;
+			return true;
+		}
+
+		run = 0;
+
+		if (now - deadline > MAX_SKIP * period)
+			deadline = now;
+
+		return false;
+	}
+
+	case Mode::Throttled:
+	{
+		const auto now = std::chrono::steady_clock::now();
+
+		if (now < deadline)
+			return true;
+
+		deadline = now + period;
+		return false;
+	}
+	}
+
+	return false;
+}
\ No newline at end of file
@@ -1,10 +1,44 @@
 #include "GUI.hpp"
 
-GUI::GUI()
+#include <algorithm>
+#include <vector>
+
+// The default build targets baseline x86-64 without AVX2, so the gather
+// path is compiled for AVX2 on its own and chosen at run time
+#if defined(__GNUC__) && (defined(__x86_64__) || defined(__i386__))
+#define CONVERT_AVX2
+#include <immintrin.h>
+#endif
+
+// 3x5 glyphs, one row per entry, bit 2 is the leftmost column
+struct Glyph
+{
+	char c;
+	uint8_t rows[5];
+};
+
+constexpr Glyph FONT[] {
+	{ '0', { 7, 5, 5, 5, 7 } }, { '1', { 2, 6, 2, 2, 7 } },
+	{ '2', { 7, 1, 7, 4, 7 } }, { '3', { 7, 1, 3, 1, 7 } },
+	{ '4', { 5, 5, 7, 1, 1 } }, { '5', { 7, 4, 7, 1, 7 } },
+	{ '6', { 7, 4, 7, 5, 7 } }, { '7', { 7, 1, 1, 1, 1 } },
+	{ '8', { 7, 5, 7, 5, 7 } }, { '9', { 7, 5, 7, 1, 7 } },
+	{ '.', { 0, 0, 0, 0, 2 } }, { 'X', { 5, 5, 2, 5, 5 } },
+	{ 'T', { 7, 2, 2, 2, 2 } }, { 'U', { 5, 5, 5, 5, 7 } },
+	{ 'R', { 6, 5, 6, 5, 5 } }, { 'B', { 6, 5, 6, 5, 6 } },
+	{ 'O', { 7, 5, 5, 5, 7 } }
+};
+
+constexpr size_t GLYPH_SCALE { 2 };
+constexpr size_t GLYPH_ADVANCE { 4 * GLYPH_SCALE };
+constexpr size_t OVERLAY_H { 7 * GLYPH_SCALE };
+
+GUI::GUI(bool vsync, ScanoutClock *scanout_ref)
+	: scanout { scanout_ref }
 {
 	// TODO: SDL_GetError
 
-	SDL_Init(SDL_INIT_EVENTS | SDL_INIT_VIDEO);
+	SDL_Init(SDL_INIT_EVENTS | SDL_INIT_VIDEO | SDL_INIT_AUDIO);
 
 	window = SDL_CreateWindow(
 		"bnes",
@@ -18,7 +52,18 @@ GUI::GUI()
 	if (window == nullptr)
 		throw std::runtime_error("Error creating SDL_Window\n");
 
-	renderer = SDL_CreateRenderer(window, -1, SDL_RENDERER_SOFTWARE);
+	// A window holds one renderer at a time, so the measuring one goes first
+	if (scanout != nullptr)
+		calibrateScanout();
+
+	const Uint32 present_flags = (vsync == true) ? SDL_RENDERER_PRESENTVSYNC : 0;
+
+	// Prefer the GPU, fall back to software where there is none
+	renderer = SDL_CreateRenderer(window, -1, SDL_RENDERER_ACCELERATED | present_flags);
+	accelerated = renderer != nullptr;
+
+	if (renderer == nullptr)
+		renderer = SDL_CreateRenderer(window, -1, SDL_RENDERER_SOFTWARE | present_flags);
 
 	if (renderer == nullptr)
 		throw std::runtime_error("Error creating SDL_Renderer\n");
@@ -31,7 +76,7 @@ GUI::GUI()
 		HEIGHT
 	);
 
-	if (renderer == nullptr)
+	if (texture == nullptr)
 		throw std::runtime_error("Error creating SDL_Texture\n");
 
 	SDL_SetRenderDrawColor(renderer, 0, 0, 0, SDL_ALPHA_OPAQUE);
@@ -39,22 +84,267 @@ GUI::GUI()
 
 GUI::~GUI()
 {
+	if (image_texture != nullptr)
+		SDL_DestroyTexture(image_texture);
+
 	SDL_DestroyTexture(texture);
 	SDL_DestroyRenderer(renderer);
 	SDL_DestroyWindow(window);
 	SDL_Quit();
 }
 
-void GUI::renderFrame(uint32_t buffer[HEIGHT][WIDTH])
+void GUI::renderFrame(
+	const uint8_t buffer[HEIGHT][WIDTH],
+	const uint8_t *emphasis,
+	const uint32_t *colors,
+	size_t first,
+	size_t last
+)
+{
+	if (first >= last)
+		return;
+
+	const Uint64 start = SDL_GetPerformanceCounter();
+
+	void *locked {};
+	int pitch {};
+
+	const SDL_Rect rows {
+		0,
+		static_cast<int>(first),
+		static_cast<int>(WIDTH),
+		static_cast<int>(last - first)
+	};
+
+	// Convert straight into the texture's memory, row by row at its pitch
+	if (SDL_LockTexture(texture, &rows, &locked, &pitch) != 0)
+		return;
+
+	const size_t stride = pitch / sizeof(uint32_t);
+	uint32_t *pixels = static_cast<uint32_t *>(locked);
+
+	for (size_t Y { first }; Y < last; ++Y)
+		convertRow(buffer[Y], colors + ((emphasis[Y] & 0x07) << 6), pixels + (Y - first) * stride);
+
+	// The overlay sits in the top rows
+	if (first == 0 && last >= OVERLAY_H)
+		drawOverlay(pixels, stride);
+
+	SDL_UnlockTexture(texture);
+
+	present(texture, start, SDL_GetPerformanceCounter());
+}
+
+void GUI::renderImage(const uint32_t *pixels, size_t width, size_t height)
 {
-	std::array<uint32_t, HEIGHT * WIDTH> pixels {};
+	const Uint64 start = SDL_GetPerformanceCounter();
+
+	if (image_texture == nullptr || image_W != width || image_H != height)
+	{
+		if (image_texture != nullptr)
+			SDL_DestroyTexture(image_texture);
+
+		image_texture = SDL_CreateTexture(
+			renderer,
+			SDL_PIXELFORMAT_ARGB8888,
+			SDL_TEXTUREACCESS_STREAMING,
+			width,
+			height
+		);
+
+		if (image_texture == nullptr)
+			throw std::runtime_error("Error creating SDL_Texture\n");
+
+		image_W = width;
+		image_H = height;
+	}
+
+	void *locked {};
+	int pitch {};
+
+	if (SDL_LockTexture(image_texture, nullptr, &locked, &pitch) != 0)
+		return;
+
+	const size_t stride = pitch / sizeof(uint32_t);
+	uint32_t *out = static_cast<uint32_t *>(locked);
+
+	for (size_t Y {}; Y < height; ++Y)
+		std::copy_n(pixels + Y * width, width, out + Y * stride);
+
+	drawOverlay(out, stride);
 
-	for (size_t Y {}; Y < HEIGHT; ++Y)
-		for (size_t X {}; X < WIDTH; ++X)
-			pixels[Y * WIDTH + X] = buffer[Y][X];
+	SDL_UnlockTexture(image_texture);
 
+	present(image_texture, start, SDL_GetPerformanceCounter());
+}
+
+void GUI::present(SDL_Texture *source, Uint64 start, Uint64 converted)
+{
 	SDL_RenderClear(renderer);
-	SDL_UpdateTexture(texture, nullptr, pixels.data(), WIDTH * 4);
-	SDL_RenderCopy(renderer, texture, nullptr, nullptr);
+	SDL_RenderCopy(renderer, source, nullptr, nullptr);
 	SDL_RenderPresent(renderer);
+
+	const Uint64 presented = SDL_GetPerformanceCounter();
+
+	const double us_per_tick = 1'000'000.0 / SDL_GetPerformanceFrequency();
+
+	present_stats.frames++;
+	present_stats.convert_us += (converted - start) * us_per_tick;
+	present_stats.present_us += (presented - converted) * us_per_tick;
+	present_stats.max_us = std::max(present_stats.max_us, (presented - start) * us_per_tick);
+}
+
+#ifdef CONVERT_AVX2
+
+__attribute__((target("avx2")))
+static void convertRowAVX2(const uint8_t *indexes, const uint32_t *colors, uint32_t *out)
+{
+	static_assert(WIDTH % 8 == 0);
+
+	// 8 palette lookups per gather
+	for (size_t X {}; X < WIDTH; X += 8)
+	{
+		const __m128i bytes = _mm_loadl_epi64(reinterpret_cast<const __m128i *>(indexes + X));
+		const __m256i index = _mm256_and_si256(
+			_mm256_cvtepu8_epi32(bytes),
+			_mm256_set1_epi32(0x3F)
+		);
+
+		_mm256_storeu_si256(
+			reinterpret_cast<__m256i *>(out + X),
+			_mm256_i32gather_epi32(reinterpret_cast<const int *>(colors), index, 4)
+		);
+	}
+}
+
+#endif
+
+void GUI::convertRow(const uint8_t *indexes, const uint32_t *colors, uint32_t *out)
+{
+#ifdef CONVERT_AVX2
+
+	static const bool avx2 = __builtin_cpu_supports("avx2");
+
+	if (avx2 == true)
+	{
+		convertRowAVX2(indexes, colors, out);
+		return;
+	}
+
+#endif
+
+	// SSE2 has no gather; this loop is the fallback on older CPUs
+	for (size_t X {}; X < WIDTH; ++X)
+		out[X] = colors[indexes[X] & 0x3F];
+}
+
+////////////////////
+// Scanout
+////////////////////
+
+void GUI::trackWindow()
+{
+	if (scanout == nullptr)
+		return;
+
+	SDL_Rect display {};
+	int X {}, Y {}, W {}, H {};
+
+	if (SDL_GetDisplayBounds(SDL_GetWindowDisplayIndex(window), &display) != 0 || display.h <= 0)
+		return;
+
+	SDL_GetWindowPosition(window, &X, &Y);
+	SDL_GetWindowSize(window, &W, &H);
+
+	scanout->setWindow(
+		static_cast<double>(Y - display.y) / display.h,
+		static_cast<double>(H) / display.h,
+		displayPeriod()
+	);
+}
+
+void GUI::calibrateScanout()
+{
+	SDL_Renderer *probe = SDL_CreateRenderer(window, -1, SDL_RENDERER_ACCELERATED | SDL_RENDERER_PRESENTVSYNC);
+
+	if (probe == nullptr)
+		probe = SDL_CreateRenderer(window, -1, SDL_RENDERER_SOFTWARE | SDL_RENDERER_PRESENTVSYNC);
+
+	std::vector<ScanoutClock::Clock::time_point> presents;
+
+	if (probe != nullptr)
+	{
+		SDL_SetRenderDrawColor(probe, 0, 0, 0, SDL_ALPHA_OPAQUE);
+
+		// Each present returns as the display flips to it
+		for (size_t i {}; i < CALIBRATION_PRESENTS; ++i)
+		{
+			SDL_RenderClear(probe);
+			SDL_RenderPresent(probe);
+			presents.push_back(ScanoutClock::Clock::now());
+		}
+
+		SDL_DestroyRenderer(probe);
+	}
+
+	if (scanout->calibrate(presents, displayPeriod()) == false)
+	{
+		std::cerr << "Display refresh could not be measured, presenting whole frames\n";
+		return;
+	}
+
+	trackWindow();
+}
+
+std::chrono::nanoseconds GUI::displayPeriod() const
+{
+	SDL_DisplayMode mode {};
+
+	if (SDL_GetCurrentDisplayMode(SDL_GetWindowDisplayIndex(window), &mode) != 0 || mode.refresh_rate <= 0)
+		return {};
+
+	return std::chrono::nanoseconds { 1'000'000'000 / mode.refresh_rate };
+}
+
+void GUI::drawOverlay(uint32_t *pixels, size_t stride) const
+{
+	if (overlay.empty() == true)
+		return;
+
+	// Dark backing box so the text reads over any picture
+	const size_t box_W = std::min(overlay.size() * GLYPH_ADVANCE + 2 * GLYPH_SCALE, WIDTH);
+	for (size_t Y {}; Y < OVERLAY_H; ++Y)
+		for (size_t X {}; X < box_W; ++X)
+			pixels[Y * stride + X] = 0xFF000000;
+
+	for (size_t i {}; i < overlay.size(); ++i)
+	{
+		const Glyph *glyph = std::find_if(
+			std::begin(FONT),
+			std::end(FONT),
+			[&](const Glyph& g) { return g.c == overlay[i]; }
+		);
+
+		if (glyph == std::end(FONT))
+			continue;
+
+		const size_t left = GLYPH_SCALE + i * GLYPH_ADVANCE;
+
+		for (size_t row {}; row < 5; ++row)
+			for (size_t col {}; col < 3; ++col)
+			{
+				if (((glyph->rows[row] >> (2 - col)) & 1) == 0)
+					continue;
+
+				for (size_t Y {}; Y < GLYPH_SCALE; ++Y)
+					for (size_t X {}; X < GLYPH_SCALE; ++X)
+					{
+						const size_t pixel_X = left + col * GLYPH_SCALE + X;
+						const size_t pixel_Y = GLYPH_SCALE + row * GLYPH_SCALE + Y;
+
+						if (pixel_X < WIDTH)
+							pixels[pixel_Y * stride + pixel_X] = 0xFFFFFFFF;
+					}
+			}
+	}
 }
\ No newline at end of file
@@ -0,0 +1,55 @@
+#include "LatencyProbe.hpp"
+
+#include "FrameHash.hpp"
+
+#include <algorithm>
+
+void LatencyProbe::press()
+{
+	const int64_t now = std::chrono::steady_clock::now().time_since_epoch().count();
+
+	int64_t idle {};
+	pressed_at.compare_exchange_strong(idle, now, std::memory_order_release);
+}
+
+void LatencyProbe::frame(const uint8_t buffer[SCREEN_H][SCREEN_W], const std::array<uint8_t, SCREEN_H>& emphasis)
+{
+	if (measuring == false)
+	{
+		if (pressed_at.load(std::memory_order_acquire) == 0)
+			return;
+
+		// The press is part of the input for the frame after this one
+		measuring = true;
+		baseline = FrameHash::frame(buffer, emphasis);
+		frames = 0;
+
+		return;
+	}
+
+	frames++;
+
+	if (FrameHash::frame(buffer, emphasis) != baseline)
+	{
+		const std::chrono::steady_clock::duration pressed {
+			pressed_at.load(std::memory_order_relaxed)
+		};
+
+		const std::chrono::duration<double, std::milli> elapsed =
+			std::chrono::steady_clock::now().time_since_epoch() - pressed;
+
+		latency_stats.presses++;
+		latency_stats.frames += frames;
+		latency_stats.ms += elapsed.count();
+		latency_stats.max_ms = std::max(latency_stats.max_ms, elapsed.count());
+	} else if (frames < TIMEOUT)
+	{
+		return;
+	} else
+	{
+		latency_stats.ignored++;
+	}
+
+	measuring = false;
+	pressed_at.store(0, std::memory_order_relaxed);
+}
\ No newline at end of file
@@ -34,6 +34,10 @@ uint8_t Logger::cpuRead(uint16_t addr)
 
 	if (addr >= 0x2000 && addr <= 0x3FFF)
 		data = ppu->readRegister(addr % 8, true);
+	else if (addr == 0x4015)
+		data = (bus->apu != nullptr) ? bus->apu->readStatus(true) : 0;
+	else if (addr == 0x4016 || addr == 0x4017)
+		data = bus->controllers[addr & 0x01].read(true);
 	else
 		data = cpu->read(addr);
 
@@ -2,11 +2,66 @@
 
 #include "Cartridge.hpp"
 
+#include <algorithm>
+
 Mapper::Mapper(Cartridge *cart_ref)
 	: cartridge { cart_ref }
+	, chr_writable { cart_ref->chr_ram }
 {
 }
 
-Mapper::~Mapper()
+////////////////////
+// Banks
+////////////////////
+
+void Mapper::mapPRG(size_t slot, size_t size, size_t bank)
+{
+	const std::vector<uint8_t>& rom = cartridge->PRG_ROM;
+
+	const size_t start = (bank % prgBanks(size)) * size;
+
+	// A bank larger than the ROM repeats it, as 16 KB does in 32 KB
+	for (size_t i {}; i < size / 0x2000; ++i)
+		prg_pages[(slot + i) & 0x03] = &rom[(start + i * 0x2000) % rom.size()];
+}
+
+void Mapper::mapCHR(size_t page, size_t size, size_t bank)
+{
+	std::vector<uint8_t>& rom = cartridge->CHR_ROM;
+
+	const size_t start = (bank % chrBanks(size)) * size;
+
+	for (size_t i {}; i < size / 0x0400; ++i)
+	{
+		const size_t index = (page + i) & 0x07;
+		uint8_t *target = &rom[(start + i * 0x0400) % rom.size()];
+
+		// Rows drawn from a page only go stale when it really moves
+		if (chr_pages[index] == target)
+			continue;
+
+		chr_pages[index] = target;
+		cartridge->chrPageSwitched(index);
+	}
+}
+
+size_t Mapper::prgBanks(size_t size) const
+{
+	return std::max<size_t>(cartridge->PRG_ROM.size() / size, 1);
+}
+
+size_t Mapper::chrBanks(size_t size) const
+{
+	return std::max<size_t>(cartridge->CHR_ROM.size() / size, 1);
+}
+
+////////////////////
+// Mirroring
+////////////////////
+
+void Mapper::mirrorSingleScreen(bool high)
 {
+	cartridge->setMirroring(high
+		? Cartridge::Mirroring::SingleScreenHigh
+		: Cartridge::Mirroring::SingleScreenLow);
 }
\ No newline at end of file
@@ -0,0 +1,88 @@
+#include "Mapper001.hpp"
+
+#include "Cartridge.hpp"
+
+Mapper001::Mapper001(Cartridge *cart_ref)
+	: Mapper { cart_ref }
+{
+	// 8 KB of PRG RAM, always enabled as on the MMC1A
+	prg_ram.resize(0x2000);
+
+	updateBanks();
+}
+
+////////////////////
+// Registers
+////////////////////
+
+void Mapper001::writeRegister(uint16_t addr, uint8_t data)
+{
+	switch ((addr >> 13) & 0x03)
+	{
+	case 0:
+	{
+		control = data;
+
+		static constexpr Cartridge::Mirroring MIRRORING[4] {
+			Cartridge::Mirroring::SingleScreenLow,
+			Cartridge::Mirroring::SingleScreenHigh,
+			Cartridge::Mirroring::Vertical,
+			Cartridge::Mirroring::Horizontal
+		};
+
+		cartridge->setMirroring(MIRRORING[control & 0x03]);
+	}
+	break;
+
+	case 1:
+		chr_bank_0 = data;
+		break;
+
+	case 2:
+		chr_bank_1 = data;
+		break;
+
+	case 3:
+		prg_bank = data;
+		break;
+	}
+
+	updateBanks();
+}
+
+void Mapper001::updateBanks()
+{
+	// 512 KB boards (SUROM) pick a 256 KB half with a CHR register bit
+	const size_t outer = (cartridge->PRG_ROM.size() > 0x40000) ? (chr_bank_0 & 0x10) : 0;
+	const size_t bank = outer | (prg_bank & 0x0F);
+
+	switch ((control >> 2) & 0x03)
+	{
+	// 32 KB at $8000
+	case 0:
+	case 1:
+		mapPRG(0, 0x8000, bank >> 1);
+		break;
+
+	// First bank fixed at $8000, 16 KB switched at $C000
+	case 2:
+		mapPRG(0, 0x4000, outer);
+		mapPRG(2, 0x4000, bank);
+		break;
+
+	// 16 KB switched at $8000, last bank fixed at $C000
+	case 3:
+		mapPRG(0, 0x4000, bank);
+		mapPRG(2, 0x4000, outer | 0x0F);
+		break;
+	}
+
+	if ((control & 0x10) != 0)
+	{
+		mapCHR(0, 0x1000, chr_bank_0);
+		mapCHR(4, 0x1000, chr_bank_1);
+	} else
+	{
+		mapCHR(0, 0x2000, chr_bank_0 >> 1);
+	}
+}
\ No newline at end of file
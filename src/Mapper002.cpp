@@ -0,0 +1,11 @@
+#include "Mapper002.hpp"
+
+#include "Cartridge.hpp"
+
+Mapper002::Mapper002(Cartridge *cart_ref)
+	: Mapper { cart_ref }
+{
+	mapPRG(0, 0x4000, 0);
+	mapPRG(2, 0x4000, prgBanks(0x4000) - 1);
+	mapCHR(0, 0x2000, 0);
+}
\ No newline at end of file
@@ -0,0 +1,11 @@
+#include "Mapper003.hpp"
+
+#include "Cartridge.hpp"
+
+Mapper003::Mapper003(Cartridge *cart_ref)
+	: Mapper { cart_ref }
+{
+	// 16 KB of PRG ROM is mirrored at $C000
+	mapPRG(0, 0x8000, 0);
+	mapCHR(0, 0x2000, 0);
+}
\ No newline at end of file
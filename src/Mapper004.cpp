@@ -0,0 +1,200 @@
+#include "Mapper004.hpp"
+
+#include "Cartridge.hpp"
+#include "PPU.hpp"
+
+Mapper004::Mapper004(Cartridge *cart_ref)
+	: Mapper { cart_ref }
+	, four_screen { cart_ref->mirroring == Cartridge::Mirroring::FourScreen }
+	, a12_dot { PPU::A12_NONE }
+{
+	// 8 KB of PRG RAM; the write protection in $A001 is not modelled
+	prg_ram.resize(0x2000);
+
+	updateBanks();
+}
+
+////////////////////
+// Data access
+////////////////////
+
+void Mapper004::writePRG(uint16_t addr, uint8_t data, uint64_t)
+{
+	if (addr < 0x8000)
+	{
+		writeRAM(addr, data);
+		return;
+	}
+
+	// Every 8 KB range holds two registers, at even and odd addresses
+	switch ((addr & 0xE000) | (addr & 0x01))
+	{
+	case 0x8000:
+		bank_select = data;
+		updateBanks();
+		break;
+
+	case 0x8001:
+		registers[bank_select & 0x07] = data;
+		updateBanks();
+		break;
+
+	case 0xA000:
+		if (four_screen == false)
+			cartridge->setMirroring(((data & 0x01) != 0)
+				? Cartridge::Mirroring::Horizontal
+				: Cartridge::Mirroring::Vertical);
+		break;
+
+	case 0xC000:
+		sync();
+		irq_latch = data;
+		schedule();
+		break;
+
+	case 0xC001:
+		sync();
+		irq_counter = 0;
+		irq_reload = true;
+		schedule();
+		break;
+
+	// Disabling also acknowledges a pending IRQ
+	case 0xE000:
+		sync();
+		irq_enabled = false;
+		irq_line = false;
+		schedule();
+		break;
+
+	case 0xE001:
+		sync();
+		irq_enabled = true;
+		schedule();
+		break;
+	}
+}
+
+void Mapper004::updateBanks()
+{
+	const size_t last = prgBanks(0x2000) - 1;
+
+	// Bit 6 swaps R6 and the second-last bank between $8000 and $C000
+	if ((bank_select & 0x40) == 0)
+	{
+		mapPRG(0, 0x2000, registers[6]);
+		mapPRG(2, 0x2000, last - 1);
+	} else
+	{
+		mapPRG(0, 0x2000, last - 1);
+		mapPRG(2, 0x2000, registers[6]);
+	}
+
+	mapPRG(1, 0x2000, registers[7]);
+	mapPRG(3, 0x2000, last);
+
+	// Bit 7 swaps the 2 KB and 1 KB halves of the pattern tables
+	const size_t invert = ((bank_select & 0x80) != 0) ? 4 : 0;
+
+	mapCHR(0 ^ invert, 0x0800, registers[0] >> 1);
+	mapCHR(2 ^ invert, 0x0800, registers[1] >> 1);
+	mapCHR(4 ^ invert, 0x0400, registers[2]);
+	mapCHR(5 ^ invert, 0x0400, registers[3]);
+	mapCHR(6 ^ invert, 0x0400, registers[4]);
+	mapCHR(7 ^ invert, 0x0400, registers[5]);
+}
+
+////////////////////
+// A12
+////////////////////
+
+void Mapper004::a12Changed()
+{
+	sync();
+	schedule();
+}
+
+void Mapper004::clockA12()
+{
+	sync();
+	clock(1);
+	schedule();
+}
+
+////////////////////
+// IRQ
+////////////////////
+
+void Mapper004::sync()
+{
+	const PPU *ppu = cartridge->ppu;
+
+	if (ppu == nullptr)
+		return;
+
+	if (a12_dot != PPU::A12_NONE && a12_dot != PPU::A12_EDGES)
+		clock(PPU::a12Rises(ppu->dots, a12_dot) - PPU::a12Rises(synced, a12_dot));
+
+	synced = ppu->dots;
+	a12_dot = ppu->a12Dot();
+}
+
+void Mapper004::clock(uint64_t count)
+{
+	if (count == 0)
+		return;
+
+	// The first clock reloads a counter that is empty or asked to reload
+	if (irq_reload == true || irq_counter == 0)
+	{
+		irq_counter = irq_latch;
+		irq_reload = false;
+	} else
+	{
+		irq_counter--;
+	}
+
+	bool zero = irq_counter == 0;
+
+	count--;
+
+	if (count <= irq_counter)
+	{
+		irq_counter -= count;
+		zero = zero || irq_counter == 0;
+	} else
+	{
+		// Down to 0, then latch, latch - 1, ... 0 every latch + 1 clocks
+		const uint64_t phase = (count - irq_counter) % (irq_latch + 1);
+
+		irq_counter = (phase == 0) ? 0 : irq_latch + 1 - phase;
+		zero = true;
+	}
+
+	if (zero == true && irq_enabled == true)
+		irq_line = true;
+}
+
+void Mapper004::schedule()
+{
+	if (irq_line == true)
+	{
+		cartridge->irq_dot = 0;
+		return;
+	}
+
+	const bool predicted = a12_dot != PPU::A12_NONE && a12_dot != PPU::A12_EDGES;
+
+	if (irq_enabled == false || predicted == false)
+	{
+		cartridge->irq_dot = Cartridge::NO_IRQ;
+		return;
+	}
+
+	// Clocks until the counter next reaches 0
+	const uint64_t count = (irq_reload == true || irq_counter == 0)
+		? irq_latch + 1
+		: irq_counter;
+
+	cartridge->irq_dot = PPU::a12After(synced, a12_dot, count);
+}
\ No newline at end of file
@@ -0,0 +1,12 @@
+#include "Mapper007.hpp"
+
+#include "Cartridge.hpp"
+
+Mapper007::Mapper007(Cartridge *cart_ref)
+	: Mapper { cart_ref }
+{
+	mapPRG(0, 0x8000, 0);
+	mapCHR(0, 0x2000, 0);
+
+	mirrorSingleScreen(false);
+}
\ No newline at end of file
@@ -0,0 +1,345 @@
+#include "NTSCFilter.hpp"
+
+#include <algorithm>
+#include <cmath>
+#include <numbers>
+
+#if defined(__AVX2__)
+#include <immintrin.h>
+#elif defined(__SSE2__)
+#include <emmintrin.h>
+#endif
+
+NTSCFilter::NTSCFilter()
+{
+	buildTables();
+
+	// Leave a core for the emulation thread and one for the post-processor
+	const size_t cores = std::thread::hardware_concurrency();
+	band_count = std::clamp<size_t>((cores > 2) ? cores - 2 : 1, 1, 4);
+
+	for (size_t band {}; band < band_count; ++band)
+		workers.emplace_back(&NTSCFilter::work, this, band);
+}
+
+NTSCFilter::~NTSCFilter()
+{
+	{
+		std::lock_guard<std::mutex> lock { mutex };
+		stopping = true;
+	}
+
+	work_ready.notify_all();
+
+	for (std::thread& worker : workers)
+		worker.join();
+}
+
+void NTSCFilter::apply(
+	const uint8_t pixels[SCREEN_H][SCREEN_W],
+	const uint8_t *emphasis,
+	size_t frame_number,
+	uint32_t *out,
+	size_t stride
+)
+{
+	std::unique_lock<std::mutex> lock { mutex };
+
+	// 341 dots of 8 samples move each line 4 samples along the subcarrier;
+	// odd frames are one dot short, so whole frames alternate by 4 as well
+	current = { pixels, emphasis, (frame_number & 1) * 4, out, stride };
+
+	job++;
+	remaining = band_count;
+
+	work_ready.notify_all();
+	work_done.wait(lock, [this] { return remaining == 0; });
+}
+
+////////////////////
+// Signal
+////////////////////
+
+void NTSCFilter::buildTables()
+{
+	// Voltages the PPU outputs for the 4 luminance rows, relative to sync
+	constexpr float low[4] { 0.350f, 0.518f, 0.962f, 1.550f };
+	constexpr float high[4] { 1.094f, 1.506f, 1.962f, 1.962f };
+	constexpr float black { 0.518f };
+	constexpr float white { 1.962f };
+
+	// Emphasis pulls the signal down during a third of the subcarrier cycle
+	constexpr float attenuation { 0.746f };
+
+	// Aligns the decoder's carrier with colorburst so hues land where the
+	// palette has them
+	constexpr float hue { 3.9f };
+
+	// A color's square wave is high for the 6 phases starting at its hue
+	const auto in_color = [](size_t hue_index, size_t phase) {
+		return (hue_index + phase) % PHASES < 6;
+	};
+
+	for (size_t index {}; index < 512; ++index)
+	{
+		const size_t emphasis = index >> 6;
+		const size_t hue_index = index & 0x0F;
+		size_t level = (index >> 4) & 0x03;
+
+		// Columns $E and $F are black on every row
+		if (hue_index > 13)
+			level = 1;
+
+		// Column 0 is a flat high level, columns $D-$F a flat low one
+		const float on = (hue_index > 12) ? low[level] : high[level];
+		const float off = (hue_index == 0) ? high[level] : low[level];
+
+		for (size_t phase {}; phase < PHASES; ++phase)
+		{
+			float signal = in_color(hue_index, phase) ? on : off;
+
+			// Red, green and blue emphasis follow hues $C, $4 and $8
+			if (((emphasis & 0b001) && in_color(0x0C, phase))
+			    || ((emphasis & 0b010) && in_color(0x04, phase))
+			    || ((emphasis & 0b100) && in_color(0x08, phase)))
+				signal *= attenuation;
+
+			signal = (signal - black) / (white - black);
+
+			const float angle = 2 * std::numbers::pi_v<float> * (phase + hue) / PHASES;
+
+			luma[index][phase] = signal;
+			in_phase[index][phase] = 2 * signal * std::cos(angle);
+			quadrature[index][phase] = 2 * signal * std::sin(angle);
+		}
+	}
+
+	// Luma averages a whole subcarrier cycle, which cancels chroma, mixed
+	// with a narrower window that keeps edges sharp and lets some chroma
+	// through as dot crawl
+	constexpr float sharpness { 0.25f };
+
+	for (size_t tap {}; tap < TAPS; ++tap)
+	{
+		if (tap >= 2 && tap < 14)
+			luma_kernel[tap] += (1 - sharpness) / 12;
+
+		if (tap >= 6 && tap < 10)
+			luma_kernel[tap] += sharpness / 4;
+	}
+
+	// Chroma is band-limited much harder, so it smears across edges: a
+	// whole cycle, which cancels the carrier left over from demodulation,
+	// widened by a triangle
+	constexpr float triangle[5] { 1, 2, 3, 2, 1 };
+
+	for (size_t start {}; start < 5; ++start)
+		for (size_t tap { start }; tap < start + 12; ++tap)
+			chroma_kernel[tap] += triangle[start] / (9 * 12);
+}
+
+void NTSCFilter::encodeLine(const uint8_t *pixels, uint8_t emphasis, size_t phase, Line& line) const
+{
+	// Blanking on both sides of the picture is at black level
+	std::fill_n(&line.Y[0][0], 4 * GROUPS, 0.0f);
+	std::fill_n(&line.I[0][0], 4 * GROUPS, 0.0f);
+	std::fill_n(&line.Q[0][0], 4 * GROUPS, 0.0f);
+
+	const size_t base = (emphasis & 0x07) << 6;
+
+	for (size_t X {}; X < SCREEN_W; ++X)
+	{
+		const size_t index = base | (pixels[X] & 0x3F);
+
+		for (size_t sample {}; sample < SAMPLES_PER_PIXEL; ++sample)
+		{
+			const size_t n = X * SAMPLES_PER_PIXEL + sample;
+			const size_t at = (phase + n) % PHASES;
+			const size_t padded = n + PAD;
+
+			line.Y[padded & 3][padded >> 2] = luma[index][at];
+			line.I[padded & 3][padded >> 2] = in_phase[index][at];
+			line.Q[padded & 3][padded >> 2] = quadrature[index][at];
+		}
+	}
+}
+
+void NTSCFilter::decodeLine(const Line& line, uint32_t *out) const
+{
+	// FCC YIQ to RGB
+	constexpr float RI { 0.956f }, RQ { 0.621f };
+	constexpr float GI { -0.272f }, GQ { -0.647f };
+	constexpr float BI { -1.106f }, BQ { 1.703f };
+
+	// Output pixel k is centred on samples 4k + 1 and 4k + 2; tap t of it
+	// reads padded sample 4k + 2 + t, which is group k + (t + 2) / 4 of
+	// split (t + 2) % 4
+
+#if defined(__AVX2__)
+
+	static_assert(OUT_W % 8 == 0);
+
+	const __m256 zero = _mm256_setzero_ps();
+	const __m256 full = _mm256_set1_ps(255.0f);
+
+	for (size_t k {}; k < OUT_W; k += 8)
+	{
+		__m256 Y = zero, I = zero, Q = zero;
+
+		for (size_t tap {}; tap < TAPS; ++tap)
+		{
+			const size_t split = (tap + 2) & 3;
+			const size_t group = k + ((tap + 2) >> 2);
+
+			const __m256 lk = _mm256_set1_ps(luma_kernel[tap]);
+			const __m256 ck = _mm256_set1_ps(chroma_kernel[tap]);
+
+			Y = _mm256_add_ps(Y, _mm256_mul_ps(lk, _mm256_loadu_ps(&line.Y[split][group])));
+			I = _mm256_add_ps(I, _mm256_mul_ps(ck, _mm256_loadu_ps(&line.I[split][group])));
+			Q = _mm256_add_ps(Q, _mm256_mul_ps(ck, _mm256_loadu_ps(&line.Q[split][group])));
+		}
+
+		const auto channel = [&](float ci, float cq) {
+			__m256 c = _mm256_add_ps(Y, _mm256_add_ps(
+				_mm256_mul_ps(_mm256_set1_ps(ci), I),
+				_mm256_mul_ps(_mm256_set1_ps(cq), Q)
+			));
+
+			c = _mm256_min_ps(_mm256_max_ps(_mm256_mul_ps(c, full), zero), full);
+
+			return _mm256_cvtps_epi32(c);
+		};
+
+		const __m256i R = channel(RI, RQ);
+		const __m256i G = channel(GI, GQ);
+		const __m256i B = channel(BI, BQ);
+
+		const __m256i argb = _mm256_or_si256(
+			_mm256_or_si256(_mm256_set1_epi32(static_cast<int>(0xFF000000)), _mm256_slli_epi32(R, 16)),
+			_mm256_or_si256(_mm256_slli_epi32(G, 8), B)
+		);
+
+		_mm256_storeu_si256(reinterpret_cast<__m256i *>(out + k), argb);
+	}
+
+#elif defined(__SSE2__)
+
+	static_assert(OUT_W % 4 == 0);
+
+	const __m128 zero = _mm_setzero_ps();
+	const __m128 full = _mm_set1_ps(255.0f);
+
+	for (size_t k {}; k < OUT_W; k += 4)
+	{
+		__m128 Y = zero, I = zero, Q = zero;
+
+		for (size_t tap {}; tap < TAPS; ++tap)
+		{
+			const size_t split = (tap + 2) & 3;
+			const size_t group = k + ((tap + 2) >> 2);
+
+			const __m128 lk = _mm_set1_ps(luma_kernel[tap]);
+			const __m128 ck = _mm_set1_ps(chroma_kernel[tap]);
+
+			Y = _mm_add_ps(Y, _mm_mul_ps(lk, _mm_loadu_ps(&line.Y[split][group])));
+			I = _mm_add_ps(I, _mm_mul_ps(ck, _mm_loadu_ps(&line.I[split][group])));
+			Q = _mm_add_ps(Q, _mm_mul_ps(ck, _mm_loadu_ps(&line.Q[split][group])));
+		}
+
+		const auto channel = [&](float ci, float cq) {
+			__m128 c = _mm_add_ps(Y, _mm_add_ps(
+				_mm_mul_ps(_mm_set1_ps(ci), I),
+				_mm_mul_ps(_mm_set1_ps(cq), Q)
+			));
+
+			c = _mm_min_ps(_mm_max_ps(_mm_mul_ps(c, full), zero), full);
+
+			return _mm_cvtps_epi32(c);
+		};
+
+		const __m128i R = channel(RI, RQ);
+		const __m128i G = channel(GI, GQ);
+		const __m128i B = channel(BI, BQ);
+
+		const __m128i argb = _mm_or_si128(
+			_mm_or_si128(_mm_set1_epi32(static_cast<int>(0xFF000000)), _mm_slli_epi32(R, 16)),
+			_mm_or_si128(_mm_slli_epi32(G, 8), B)
+		);
+
+		_mm_storeu_si128(reinterpret_cast<__m128i *>(out + k), argb);
+	}
+
+#else
+
+	for (size_t k {}; k < OUT_W; ++k)
+	{
+		float Y {}, I {}, Q {};
+
+		for (size_t tap {}; tap < TAPS; ++tap)
+		{
+			const size_t split = (tap + 2) & 3;
+			const size_t group = k + ((tap + 2) >> 2);
+
+			Y += luma_kernel[tap] * line.Y[split][group];
+			I += chroma_kernel[tap] * line.I[split][group];
+			Q += chroma_kernel[tap] * line.Q[split][group];
+		}
+
+		const auto channel = [&](float ci, float cq) {
+			const float c = std::clamp((Y + ci * I + cq * Q) * 255.0f, 0.0f, 255.0f);
+
+			return static_cast<uint32_t>(std::lround(c));
+		};
+
+		out[k] = 0xFF000000
+			| (channel(RI, RQ) << 16)
+			| (channel(GI, GQ) << 8)
+			| channel(BI, BQ);
+	}
+
+#endif
+}
+
+////////////////////
+// Workers
+////////////////////
+
+void NTSCFilter::work(size_t band)
+{
+	// Each worker decodes its lines through its own sample buffer
+	Line line;
+
+	size_t done {};
+
+	while (true)
+	{
+		Job frame {};
+
+		{
+			std::unique_lock<std::mutex> lock { mutex };
+
+			work_ready.wait(lock, [&] { return stopping == true || job != done; });
+
+			if (stopping == true)
+				return;
+
+			done = job;
+			frame = current;
+		}
+
+		const size_t height = (SCREEN_H + band_count - 1) / band_count;
+		const size_t first = std::min(band * height, SCREEN_H);
+		const size_t last = std::min(first + height, SCREEN_H);
+
+		for (size_t Y { first }; Y < last; ++Y)
+		{
+			encodeLine(frame.pixels[Y], frame.emphasis[Y], (frame.phase + 4 * Y) % PHASES, line);
+			decodeLine(line, frame.out + Y * frame.stride);
+		}
+
+		std::lock_guard<std::mutex> lock { mutex };
+
+		if (--remaining == 0)
+			work_done.notify_one();
+	}
+}
\ No newline at end of file
@@ -1,7 +1,9 @@
 #include "PPU.hpp"
 
+#include "BandRenderer.hpp"
 #include "Bus.hpp"
 
+#include <algorithm>
 #include <iomanip>
 #include <iostream>
 
@@ -22,32 +24,102 @@ PPU::PPU(Bus& bus_ref)
 	for (size_t Y {}; Y < SCREEN_H; ++Y)
 		for (size_t X {}; X < SCREEN_W; ++X)
 			buffer[Y][X] = 0;
+
+	buildColorLUT();
+	resolvePalettes();
+
+	setMirroring(Cartridge::Mirroring::Horizontal);
 }
 
 PPU::~PPU()
 {
 }
 
+void PPU::setDeferredRendering(bool enabled)
+{
+	if (enabled == true && band_renderer == nullptr)
+		band_renderer = std::make_unique<BandRenderer>();
+
+	// Takes effect from the next frame
+	deferred = enabled;
+}
+
 ////////////////////
 // Timing
 ////////////////////
 
-void PPU::step(uint8_t ppu_cycles)
+void PPU::step(uint16_t ppu_cycles)
 {
-	cycles += ppu_cycles;
-	bool first_cycle = false;
+	dots += ppu_cycles;
 
-	// A scanline occurs every 341 PPU cycles
-	if (cycles >= 341)
+	while (ppu_cycles > 0)
 	{
-		cycles -= 341;
+		if (sprite_0_stale == true)
+			predictSprite0();
+
+		// Dot 257 ends the visible part of a line, dot 341 ends the line
+		size_t event = (cycles < 257) ? 257 : 341;
+
+		// A predicted sprite 0 hit on this line is an event of its own
+		if (sprite_0_dot / 341 == scanlines && sprite_0_dot % 341 < event)
+			event = sprite_0_dot % 341;
+
+		const size_t run = std::min<size_t>(event - cycles, ppu_cycles);
+
+		cycles += run;
+		ppu_cycles -= run;
+
+		if (scanlines * 341 + cycles == sprite_0_dot)
+		{
+			PPUSTATUS.sprite_0_hit = 1;
+			sprite_0_dot = NO_HIT;
+		}
+
+		if (cycles == 257)
+		{
+			if (scanlines < SCREEN_H && deferring == true)
+				band_renderer->recording().lines[scanlines] = liveLine();
+			else if (scanlines < SCREEN_H && skipping == false)
+			{
+				renderScanline(scanlines);
+				rows_ready = scanlines + 1;
+			}
+
+			if (renderingEnabled() == true && (scanlines < SCREEN_H || scanlines == 261))
+			{
+				incrementY(vram_addr);
+				copyX(vram_addr);
+
+				// Pre-render line reloads the vertical scroll (dots 280-304)
+				// and the next frame's sprite 0 hit can be predicted
+				if (scanlines == 261)
+				{
+					copyY(vram_addr);
+					sprite_0_stale = true;
+				}
+
+				// Sprites for the next line are gathered during this one
+				evaluateSprites(scanlines == 261 ? 0 : scanlines + 1);
+
+				// 8x16 sprites pick their own pattern table; only the ones
+				// fetched show whether this line raises A12
+				if (PPUCTRL.sprite_size == 1 && spritesRaiseA12() == true)
+					bus->cartridge->clockA12();
+			}
+		}
+
+		if (cycles < 341)
+			continue;
+
+		// A scanline occurs every 341 PPU cycles
+		cycles = 0;
 		scanlines++;
-		first_cycle = true;
 
 		// NMI interrupt is triggered on scanline 241
-		if (scanlines == 241 && first_cycle == true)
+		if (scanlines == 241)
 		{
 			PPUSTATUS.vblank = 1; // signal start of vblank
+			finishFrame();
 
 			if (PPUCTRL.generate_nmi == 1)
 			{
@@ -55,16 +127,79 @@ void PPU::step(uint8_t ppu_cycles)
 			}
 		}
 
+		// Pre-render line ends vblank and clears the sprite flags
+		if (scanlines == 261)
+		{
+			PPUSTATUS.vblank = 0;
+			PPUSTATUS.sprite_0_hit = 0;
+			PPUSTATUS.sprite_overflow = 0;
+			sprite_0_dot = NO_HIT;
+		}
+
 		// PPU renders 262 scanlines per frame
 		if (scanlines >= 262)
 		{
-			PPUSTATUS.vblank = 0; // end of vblank
 			scanlines = 0;
-			update_screen = true;
+			beginFrame();
 		}
 	}
 }
 
+////////////////////
+// A12
+////////////////////
+
+size_t PPU::a12Dot() const
+{
+	if (renderingEnabled() == false)
+		return A12_NONE;
+
+	if (PPUCTRL.sprite_size == 1)
+		return A12_EDGES;
+
+	// Sprites are fetched at dots 257-320, the next line's first two
+	// background tiles at 321-336
+	if (PPUCTRL.background_pt_addr == 0 && PPUCTRL.addr_pt_fg == 1)
+		return 260;
+
+	if (PPUCTRL.background_pt_addr == 1 && PPUCTRL.addr_pt_fg == 0)
+		return 324;
+
+	// Both tables alike: A12 never stays low long enough to count a rise
+	return A12_NONE;
+}
+
+uint64_t PPU::a12Rises(uint64_t dot, size_t a12_dot)
+{
+	constexpr uint64_t FRAME { 262 * 341 };
+
+	const size_t line = (dot % FRAME) / 341;
+	const size_t rise = ((dot % FRAME) % 341 > a12_dot) ? 1 : 0;
+
+	// 241 rendered lines per frame, the pre-render line last
+	uint64_t rises = (dot / FRAME) * 241;
+
+	if (line < SCREEN_H)
+		rises += line + rise;
+	else if (line < 261)
+		rises += SCREEN_H;
+	else
+		rises += SCREEN_H + rise;
+
+	return rises;
+}
+
+uint64_t PPU::a12After(uint64_t dot, size_t a12_dot, uint64_t count)
+{
+	constexpr uint64_t FRAME { 262 * 341 };
+
+	// Index of the last rise counted, from power on
+	const uint64_t index = a12Rises(dot, a12_dot) + count - 1;
+	const size_t line = (index % 241 < SCREEN_H) ? index % 241 : 261;
+
+	return (index / 241) * FRAME + line * 341 + a12_dot + 1;
+}
+
 ////////////////////
 // Data Access
 ////////////////////
@@ -102,11 +237,19 @@ uint8_t PPU::readRegister(uint16_t index, bool read_only)
 	{
 	// PPUSTATUS
 	case 2:
+		if (sprite_0_stale == true)
+			predictSprite0();
+
 		data = (PPUSTATUS.val & 0b11100000) | (internal_buffer & 0b00011111);
 		PPUSTATUS.vblank = 0;
 		latch = false;
 		break;
 
+	// OAMDATA
+	case 4:
+		data = OAM[oam_addr];
+		break;
+
 	// PPUDATA
 	case 7:
 	{
@@ -141,17 +284,57 @@ void PPU::writeRegister(uint16_t index, uint8_t data)
 	{
 	// PPUCTRL
 	case 0:
+	{
+		const size_t a12 = a12Dot();
+
 		PPUCTRL.val = data;
 		temp_addr.nt_select = PPUCTRL.base_nt_addr;
-		break;
+		sprite_0_stale = true;
+
+		// Mappers counting lines reschedule when the pattern tables move
+		if (a12Dot() != a12)
+			bus->cartridge->a12Changed();
+	}
+	break;
 
 	// PPUMASK
 	case 1:
+	{
+		const size_t a12 = a12Dot();
+
+		// Greyscale changes every color; emphasis is kept per line instead
+		const bool recolor = ((PPUMASK.val ^ data) & 0b00000001) != 0;
+
 		PPUMASK.val = data;
+		sprite_0_stale = true;
+
+		if (recolor == true)
+		{
+			resolvePalettes();
+			palette_generation++;
+		}
+
+		if (a12Dot() != a12)
+			bus->cartridge->a12Changed();
+	}
+	break;
+
+	// OAMADDR
+	case 3:
+		oam_addr = data;
+		break;
+
+	// OAMDATA
+	case 4:
+		logWrite(WriteTarget::OAM, oam_addr, data);
+		OAM[oam_addr++] = data;
+		sprite_0_stale = true;
 		break;
 
 	// PPUSCROLL
 	case 5:
+		sprite_0_stale = true;
+
 		if (latch == false)
 		{
 			temp_addr.coarse_x = data >> 3;
@@ -167,6 +350,8 @@ void PPU::writeRegister(uint16_t index, uint8_t data)
 
 	// PPUADDR
 	case 6:
+		sprite_0_stale = true;
+
 		if (latch == false)
 		{
 			temp_addr.h = data & 0b00111111;
@@ -191,145 +376,827 @@ void PPU::writeRegister(uint16_t index, uint8_t data)
 	}
 }
 
-const PPU::Tile PPU::getTile(uint8_t id) const
+void PPU::setMirroring(Cartridge::Mirroring mirroring)
+{
+	switch (mirroring)
+	{
+	case Cartridge::Mirroring::Horizontal:
+		nametable_map = { 0, 0, 1, 1 };
+		break;
+	case Cartridge::Mirroring::Vertical:
+		nametable_map = { 0, 1, 0, 1 };
+		break;
+	case Cartridge::Mirroring::SingleScreenLow:
+		nametable_map = { 0, 0, 0, 0 };
+		break;
+	case Cartridge::Mirroring::SingleScreenHigh:
+		nametable_map = { 1, 1, 1, 1 };
+		break;
+	case Cartridge::Mirroring::FourScreen:
+		nametable_map = { 0, 1, 2, 3 };
+		break;
+	}
+
+	Nametable *const pages[] {
+		&nametable_0, &nametable_1, &nametable_2, &nametable_3
+	};
+
+	for (size_t i {}; i < nametables.size(); ++i)
+	{
+		nametables[i] = pages[nametable_map[i]];
+		logWrite(WriteTarget::NametableMap, i, nametable_map[i]);
+	}
+
+	// Every row may now read a different page
+	for (RowCache& row : row_cache)
+		row.generation = 0;
+
+	sprite_0_stale = true;
+}
+
+const PPU::Nametable& PPU::getNametable(size_t index) const
+{
+	return *nametables[index & 0x03];
+}
+
+void PPU::writeNametable(size_t index, uint16_t offset, uint8_t data)
 {
-	uint16_t offset {};
+	Nametable& nametable = *nametables[index & 0x03];
 
-	if (PPUCTRL.background_pt_addr == 1)
-		offset = 0x1000;
+	// Generations belong to the physical page, shared by its mirrors
+	index = nametable_map[index & 0x03];
 
-	///////////////////////////////////////////////
-	// Load bytes
-	///////////////////////////////////////////////
-	// 0-7: 18 38 18 18 18 18 7E 00 (low)
-	// 8-F: 00 00 00 00 00 00 00 00 (high)
-	///////////////////////////////////////////////
+	offset &= 0x03FF;
 
-	std::array<uint8_t, 8> lo_bytes {};
-	std::array<uint8_t, 8> hi_bytes {};
+	if (nametable[offset] == data)
+		return;
 
-	for (size_t i {}; i < 8; ++i)
+	nametable[offset] = data;
+	tile_generation[index][offset] = ++generation;
+	logWrite(WriteTarget::Nametable, index * 0x0400 + offset, data);
+	sprite_0_stale = true;
+
+	// Attribute bytes recolor the 4x4 tiles beneath them
+	if (offset >= 0x03C0)
 	{
-		lo_bytes[i] = bus->ppuRead(offset + 16 * id + i);
-		hi_bytes[i] = bus->ppuRead(offset + 16 * id + i + 8);
+		const size_t X = ((offset - 0x03C0) & 0x07) * 4;
+		const size_t Y = ((offset - 0x03C0) >> 3) * 4;
+
+		for (size_t tile_Y { Y }; tile_Y < std::min(Y + 4, NAMETABLE_H); ++tile_Y)
+			for (size_t tile_X { X }; tile_X < X + 4; ++tile_X)
+				tile_generation[index][tile_Y * NAMETABLE_W + tile_X] = generation;
 	}
+}
+
+void PPU::markPatternDirty(uint16_t addr)
+{
+	// 16 bytes per tile, 256 tiles per pattern table
+	pattern_generation[(addr >> 4) & 0x01FF] = ++generation;
+	sprite_0_stale = true;
+
+	if (deferring == true)
+		logWrite(WriteTarget::Pattern, addr, readPattern(liveSource(), addr));
+}
+
+void PPU::markPatternPageDirty(size_t page)
+{
+	// A mapper pointed a 1 KB page, 64 tiles, at another bank
+	page &= 0x07;
+
+	std::fill_n(&pattern_generation[page * 64], 64, ++generation);
+	sprite_0_stale = true;
+
+	if (deferring == false)
+		return;
+
+	const uint8_t *data = bus->cartridge->chrPage(page);
+
+	for (uint16_t offset {}; offset < 0x0400; ++offset)
+		logWrite(WriteTarget::Pattern, page * 0x0400 + offset, data[offset]);
+}
+
+////////////////////
+// Rendering
+////////////////////
+
+bool PPU::renderingEnabled() const
+{
+	return PPUMASK.show_bg == 1 || PPUMASK.show_fg == 1;
+}
+
+PPU::RenderSource PPU::liveSource() const
+{
+	RenderSource source {};
+
+	for (size_t i {}; i < source.nametables.size(); ++i)
+		source.nametables[i] = nametables[i];
+
+	// Pages are looked up per line so mapper bank switches take effect
+	for (size_t i {}; i < source.patterns.size(); ++i)
+		source.patterns[i] = bus->cartridge->chrPage(i);
 
-	////////////////////
-	// Build tile
-	////////////////////
+	source.colors = active_palette.data();
 
-	Tile tile {};
+	return source;
+}
+
+PPU::LineState PPU::liveLine() const
+{
+	return { vram_addr, fine_x_scroll, PPUCTRL, PPUMASK };
+}
+
+void PPU::renderScanline(size_t line)
+{
+	const RenderSource source = liveSource();
+	const LineState state = liveLine();
 
-	for (size_t Y {}; Y < TILE_H; ++Y)
+	RowCache& row = row_cache[line];
+
+	const uint8_t mode = state.ctrl.background_pt_addr
+		| (state.mask.show_bg << 1)
+		| (state.mask.show_bg_leftmost << 2);
+
+	// Anything that moves the row on screen invalidates all of it
+	const bool full = row.generation == 0
+		|| row.vram_addr != state.v.val
+		|| row.fine_x != state.fine_x
+		|| row.mode != mode;
+
+	size_t tiles {};
+
+	if (state.mask.show_bg == 1)
 	{
-		for (size_t X {}; X < TILE_W; ++X)
+		const size_t pattern_table = state.ctrl.background_pt_addr << 8;
+
+		LoopyAddress v = state.v;
+
+		// 33 tiles cover 256 pixels at any fine X scroll
+		for (size_t slot {}; slot <= NAMETABLE_W; ++slot)
 		{
-			const uint8_t pixel_lo = (lo_bytes[Y] >> (7 - X)) & 1;
-			const uint8_t pixel_hi = (hi_bytes[Y] >> (7 - X)) & 1;
-			const uint8_t pixel = pixel_lo | (pixel_hi << 1);
+			const size_t offset = v.coarse_y * NAMETABLE_W + v.coarse_x;
+			const uint8_t tile_id = (*source.nametables[v.nt_select])[offset];
 
-			tile[(8 * Y) + X] = pixel;
+			if (full == true
+			    || tile_generation[nametable_map[v.nt_select]][offset] > row.generation
+			    || pattern_generation[pattern_table | tile_id] > row.generation)
+			{
+				uint8_t lo {};
+				uint8_t hi {};
+
+				const uint8_t palette = fetchTile(source, state, v, lo, hi);
+
+				renderTile(
+					bg_index[line],
+					static_cast<int>(slot * TILE_W) - state.fine_x,
+					lo,
+					hi,
+					palette
+				);
+
+				tiles++;
+			}
+
+			nextTile(v);
 		}
+
+		if (tiles > 0 && state.mask.show_bg_leftmost == 0)
+			std::fill_n(bg_index[line], TILE_W, 0);
+	} else if (full == true)
+	{
+		std::fill_n(bg_index[line], SCREEN_W, 0);
+	}
+
+	dirty_stats.tiles_rendered += tiles;
+
+	const bool sprites = state.mask.show_fg == 1 && sprite_count > 0;
+
+	if (sprites == true)
+		renderSprites(source, state, line, secondary_oam.data(), sprite_count, sprite_line.data());
+
+	// Lines that carried sprites last frame must be recomposed without them
+	if (full == true
+	    || tiles > 0
+	    || sprites == true
+	    || row.sprites == true
+	    || row.palette_generation != palette_generation)
+	{
+		mergeRow(
+			bg_index[line],
+			(sprites == true) ? sprite_line.data() : nullptr,
+			source.colors,
+			buffer[line]
+		);
+
+		rows_changed++;
+		dirty_stats.rows_rendered++;
+	} else
+	{
+		dirty_stats.rows_reused++;
+	}
+
+	// Emphasis travels beside the row, so changing it needs no redraw
+	if (emphasis[line] != state.mask.val >> 5)
+	{
+		emphasis[line] = state.mask.val >> 5;
+		rows_changed++;
 	}
 
-	return tile;
+	row.vram_addr = state.v.val;
+	row.fine_x = state.fine_x;
+	row.mode = mode;
+	row.generation = generation;
+	row.palette_generation = palette_generation;
+	row.sprites = sprites;
 }
 
-const PPU::Nametable& PPU::getNametable() const
+void PPU::finishFrame()
 {
-	switch (PPUCTRL.base_nt_addr)
+	frame_dirty = rows_changed > 0 || collected == true;
+	rows_changed = 0;
+
+	// Deferred frames reach buffer one frame late, once their bands are done
+	if (deferring == true)
 	{
-	case 0:
-		return nametable_0;
-	case 1:
-		return nametable_1;
-	case 2:
-		return nametable_2;
-	case 3:
-		return nametable_3;
-	default:
-		return nametable_0;
+		frame_dirty = band_renderer->collect(buffer, emphasis);
+		band_renderer->submit();
+	}
+
+	if (deferring == true || collected == true)
+		dirty_stats.rows_rendered += (frame_dirty == true) ? SCREEN_H : 0;
+
+	collected = false;
+
+	dirty_stats.frames++;
+
+	if (skipping == true)
+		dirty_stats.frames_skipped++;
+	else if (frame_dirty == false)
+		dirty_stats.frames_reused++;
+
+	update_screen = true;
+}
+
+uint8_t PPU::readPattern(const RenderSource& source, uint16_t addr)
+{
+	return source.patterns[(addr >> 10) & 0x07][addr & 0x03FF];
+}
+
+void PPU::nextTile(LoopyAddress& v)
+{
+	if (v.coarse_x == 31)
+	{
+		v.coarse_x = 0;
+		v.nt_select ^= 1;
+	} else
+	{
+		v.coarse_x++;
 	}
 }
 
-void PPU::getPalettes(
-	size_t X,
-	size_t Y,
-	uint8_t& col_0,
-	uint8_t& col_1,
-	uint8_t& col_2,
-	uint8_t& col_3
+uint8_t PPU::fetchTile(
+	const RenderSource& source,
+	const LineState& state,
+	LoopyAddress v,
+	uint8_t& lo,
+	uint8_t& hi
 )
 {
-	const Nametable& nametable = getNametable();
+	const Nametable& nametable = *source.nametables[v.nt_select];
 
-	const size_t offset = (8 * (Y / 4)) + (X / 4);
+	const uint8_t tile_id = nametable[v.coarse_y * NAMETABLE_W + v.coarse_x];
 
-	uint8_t block = nametable[0x03C0 + offset];
+	const uint8_t block = nametable[
+		0x03C0 | ((v.coarse_y >> 2) << 3) | (v.coarse_x >> 2)
+	];
+	const uint8_t shift = ((v.coarse_y & 2) << 1) | (v.coarse_x & 2);
 
-	col_0 = vram_palettes[4 * (block & 0b00000011)];
-	col_1 = vram_palettes[4 * ((block & 0b00110000) >> 4)];
-	col_2 = vram_palettes[4 * ((block & 0b00001100) >> 2)];
-	col_3 = vram_palettes[4 * ((block & 0b11000000) >> 6)];
+	const uint16_t addr = (state.ctrl.background_pt_addr << 12) + 16 * tile_id + v.fine_y;
+
+	lo = readPattern(source, addr);
+	hi = readPattern(source, addr + 8);
+
+	return (block >> shift) & 0b00000011;
 }
 
-void PPU::updateBuffer()
+void PPU::renderTile(uint8_t *row, int X, uint8_t lo, uint8_t hi, uint8_t palette)
 {
-	const Nametable& nametable = getNametable();
+	for (int tile_X {}; tile_X < static_cast<int>(TILE_W); ++tile_X)
+	{
+		const int pixel_X = X + tile_X;
 
-	////////////////////
-	// Clear buffer
-	////////////////////
+		if (pixel_X < 0 || pixel_X >= static_cast<int>(SCREEN_W))
+			continue;
 
-	for (size_t Y {}; Y < SCREEN_H; ++Y)
+		const uint8_t pixel_lo = (lo >> (7 - tile_X)) & 1;
+		const uint8_t pixel_hi = (hi >> (7 - tile_X)) & 1;
+		const uint8_t pixel = pixel_lo | (pixel_hi << 1);
+
+		// Pixel 0 of every palette shows the backdrop
+		row[pixel_X] = (pixel == 0) ? 0 : (4 * palette) | pixel;
+	}
+}
+
+void PPU::renderBackground(const RenderSource& source, const LineState& state, uint8_t *row)
+{
+	if (state.mask.show_bg == 0)
+	{
+		std::fill_n(row, SCREEN_W, 0);
+		return;
+	}
+
+	LoopyAddress v = state.v;
+
+	for (size_t slot {}; slot <= NAMETABLE_W; ++slot)
+	{
+		uint8_t lo {};
+		uint8_t hi {};
+
+		const uint8_t palette = fetchTile(source, state, v, lo, hi);
+
+		renderTile(row, static_cast<int>(slot * TILE_W) - state.fine_x, lo, hi, palette);
+		nextTile(v);
+	}
+
+	if (state.mask.show_bg_leftmost == 0)
+		std::fill_n(row, TILE_W, 0);
+}
+
+void PPU::mergeRow(
+	const uint8_t *bg,
+	const uint8_t *sprites,
+	const uint8_t *colors,
+	uint8_t *out
+)
+{
+	if (sprites == nullptr)
+	{
 		for (size_t X {}; X < SCREEN_W; ++X)
-			buffer[Y][X] = 0;
+			out[X] = colors[bg[X]];
+
+		return;
+	}
+
+	// Sprite pixels win unless they sit behind an opaque background pixel;
+	// written as masks so the loop vectorizes
+	std::array<uint8_t, SCREEN_W> merged;
+
+	for (size_t X {}; X < SCREEN_W; ++X)
+	{
+		const uint8_t sprite = sprites[X];
+		const uint8_t opaque_bg = bg[X] != 0;
+		const uint8_t opaque_fg = (sprite & 0x1F) != 0;
+		const uint8_t front = (sprite & SPRITE_BEHIND) == 0;
+
+		const uint8_t mask = -(opaque_fg & (front | (opaque_bg ^ 1)));
+
+		merged[X] = ((sprite & 0x1F) & mask) | (bg[X] & ~mask);
+	}
+
+	for (size_t X {}; X < SCREEN_W; ++X)
+		out[X] = colors[merged[X]];
+}
+
+////////////////////
+// Sprites
+////////////////////
+
+void PPU::writeOAM(const uint8_t *page)
+{
+	// DMA starts at OAMADDR and wraps around
+	std::copy_n(page, OAM.size() - oam_addr, OAM.begin() + oam_addr);
+	std::copy_n(page + OAM.size() - oam_addr, oam_addr, OAM.begin());
+
+	if (deferring == true)
+		for (size_t i {}; i < OAM.size(); ++i)
+			logWrite(WriteTarget::OAM, i, OAM[i]);
+
+	sprite_0_stale = true;
+}
+
+void PPU::evaluateSprites(size_t line)
+{
+	bool overflow {};
+
+	sprite_count = findSprites(OAM.data(), PPUCTRL, line, secondary_oam.data(), overflow);
+
+	if (overflow == true)
+		PPUSTATUS.sprite_overflow = 1;
+}
+
+bool PPU::spritesRaiseA12() const
+{
+	// Empty slots fetch tile $FF, from $1000
+	bool high = sprite_count < secondary_oam.size();
+	bool low {};
+
+	for (size_t i {}; i < sprite_count; ++i)
+	{
+		if ((secondary_oam[i].tile & 0x01) != 0)
+			high = true;
+		else
+			low = true;
+	}
+
+	// A12 rises when the sprites leave the background's table for $1000,
+	// or when the background returns to $1000 after sprites at $0000
+	return (PPUCTRL.background_pt_addr == 0) ? high : low;
+}
+
+size_t PPU::findSprites(
+	const uint8_t *oam,
+	Control ctrl,
+	size_t line,
+	Sprite *found,
+	bool& overflow
+)
+{
+	// Pre-render line fetches no sprites for line 0
+	if (line == 0)
+		return 0;
+
+	const size_t height = (ctrl.sprite_size == 1) ? 16 : 8;
+
+	size_t count {};
+
+	for (size_t i {}; i < 64; ++i)
+	{
+		// Sprites are drawn one line below their Y coordinate
+		const size_t row = line - 1 - oam[4 * i];
+
+		if (row >= height)
+			continue;
+
+		if (count == 8)
+		{
+			overflow = true;
+			break;
+		}
+
+		found[count++] = {
+			oam[4 * i],
+			oam[4 * i + 1],
+			oam[4 * i + 2],
+			oam[4 * i + 3]
+		};
+	}
+
+	return count;
+}
+
+void PPU::renderSprites(
+	const RenderSource& source,
+	const LineState& state,
+	size_t line,
+	const Sprite *sprites,
+	size_t count,
+	uint8_t *out
+)
+{
+	std::fill_n(out, SCREEN_W, 0);
+
+	// Draw back to front so lower OAM indexes end up on top
+	for (size_t i = count; i-- > 0;)
+	{
+		const Sprite& sprite = sprites[i];
+
+		uint8_t lo {};
+		uint8_t hi {};
+
+		fetchSpriteRow(source, state.ctrl, sprite, line, lo, hi);
+
+		const uint8_t flags = 0x10
+			| ((sprite.attributes & 0b00000011) << 2)
+			| ((sprite.attributes & 0x20) ? SPRITE_BEHIND : 0);
+
+		for (size_t tile_X {}; tile_X < TILE_W; ++tile_X)
+		{
+			const size_t X = sprite.X + tile_X;
+
+			if (X >= SCREEN_W)
+				break;
+
+			const size_t bit = 7 - tile_X;
+			const uint8_t pixel = ((lo >> bit) & 1) | (((hi >> bit) & 1) << 1);
+
+			if (pixel != 0)
+				out[X] = flags | pixel;
+		}
+	}
+
+	if (state.mask.show_fg_leftmost == 0)
+		std::fill_n(out, TILE_W, 0);
+}
+
+void PPU::fetchSpriteRow(
+	const RenderSource& source,
+	Control ctrl,
+	const Sprite& sprite,
+	size_t line,
+	uint8_t& lo,
+	uint8_t& hi
+)
+{
+	const size_t height = (ctrl.sprite_size == 1) ? 16 : 8;
+
+	size_t row = line - 1 - sprite.Y;
+
+	if (sprite.attributes & 0x80)
+		row = height - 1 - row;
+
+	uint16_t addr {};
+
+	if (height == 16)
+	{
+		// 8x16 sprites select their pattern table with bit 0
+		const uint16_t pattern_table = (sprite.tile & 1) ? 0x1000 : 0x0000;
+		const uint8_t tile = (sprite.tile & 0xFE) + (row >= 8);
+
+		addr = pattern_table + 16 * tile + (row & 7);
+	} else
+	{
+		const uint16_t pattern_table = ctrl.addr_pt_fg ? 0x1000 : 0x0000;
+
+		addr = pattern_table + 16 * sprite.tile + row;
+	}
+
+	lo = readPattern(source, addr);
+	hi = readPattern(source, addr + 8);
+
+	// Horizontal flip, so bit 7 is always the leftmost pixel
+	if (sprite.attributes & 0x40)
+	{
+		for (uint8_t *byte : { &lo, &hi })
+		{
+			uint8_t flipped {};
+
+			for (size_t bit {}; bit < 8; ++bit)
+				flipped |= ((*byte >> bit) & 1) << (7 - bit);
+
+			*byte = flipped;
+		}
+	}
+}
+
+////////////////////
+// Sprite 0 hit
+////////////////////
+
+bool PPU::backgroundOpaque(const RenderSource& source, LoopyAddress v, size_t X) const
+{
+	const size_t pixel_X = fine_x_scroll + X;
+
+	// Walk to the tile holding the pixel, wrapping into the next nametable
+	const size_t coarse_X = v.coarse_x + pixel_X / TILE_W;
+
+	if (coarse_X >= NAMETABLE_W)
+		v.nt_select ^= 1;
+
+	v.coarse_x = coarse_X % NAMETABLE_W;
 
-	////////////////////
-	// Fill temp buffer
-	////////////////////
+	uint8_t lo {};
+	uint8_t hi {};
 
-	for (size_t Y {}; Y < NAMETABLE_H; ++Y)
+	fetchTile(source, liveLine(), v, lo, hi);
+
+	const size_t bit = 7 - (pixel_X % TILE_W);
+
+	return (((lo | hi) >> bit) & 1) != 0;
+}
+
+void PPU::predictSprite0()
+{
+	sprite_0_stale = false;
+	sprite_0_dot = NO_HIT;
+
+	if (PPUSTATUS.sprite_0_hit == 1 || PPUMASK.show_bg == 0 || PPUMASK.show_fg == 0)
+		return;
+
+	// Lines are drawn at dot 257, by which point v already targets the next;
+	// from the end of the pre-render line v holds the next frame's line 0
+	size_t line {};
+
+	if (scanlines < SCREEN_H)
+		line = (cycles < 257) ? scanlines : scanlines + 1;
+	else if (scanlines != 261 || cycles < 257)
+		return;
+
+	const RenderSource source = liveSource();
+
+	LoopyAddress v = vram_addr;
+
+	const Sprite sprite { OAM[0], OAM[1], OAM[2], OAM[3] };
+
+	const size_t height = (PPUCTRL.sprite_size == 1) ? 16 : 8;
+	const size_t top = sprite.Y + 1;
+	const size_t bottom = std::min(top + height, SCREEN_H);
+
+	// Pixels that can never hit: the clipped left edge and X = 255
+	const size_t left = (PPUMASK.show_bg_leftmost == 0 || PPUMASK.show_fg_leftmost == 0)
+		? TILE_W : 0;
+
+	for (; line < bottom; ++line)
 	{
-		for (size_t X {}; X < NAMETABLE_W; ++X)
+		if (line >= top)
 		{
-			uint8_t color_0 {};
-			uint8_t color_1 {};
-			uint8_t color_2 {};
-			uint8_t color_3 {};
+			uint8_t lo {};
+			uint8_t hi {};
 
-			getPalettes(X, Y, color_0, color_1, color_2, color_3);
+			fetchSpriteRow(source, PPUCTRL, sprite, line, lo, hi);
 
-			// Get tile
-			const uint8_t tile_id = nametable[Y * 32 + X];
-			const Tile tile = getTile(tile_id);
+			const uint8_t opaque = lo | hi;
 
-			for (size_t tile_Y {}; tile_Y < 8; ++tile_Y)
+			for (size_t tile_X {}; tile_X < TILE_W && opaque != 0; ++tile_X)
 			{
-				for (size_t tile_X {}; tile_X < 8; ++tile_X)
-				{
-					const uint8_t pixel = tile[8 * tile_Y + tile_X];
-
-					switch (pixel)
-					{
-					case 0:
-						buffer[Y * 8 + tile_Y][X * 8 + tile_X] = palettes[0x0f];
-						break;
-					case 1:
-						buffer[Y * 8 + tile_Y][X * 8 + tile_X] = palettes[0x2c];
-						break;
-					case 2:
-						buffer[Y * 8 + tile_Y][X * 8 + tile_X] = palettes[0x38];
-						break;
-					case 3:
-						buffer[Y * 8 + tile_Y][X * 8 + tile_X] = palettes[0x12];
-						break;
-					default:
-						buffer[Y * 8 + tile_Y][X * 8 + tile_X] = palettes[0x0f];
-						break;
-					}
-				}
+				const size_t X = sprite.X + tile_X;
+
+				if (X < left || X >= SCREEN_W - 1 || ((opaque >> (7 - tile_X)) & 1) == 0)
+					continue;
+
+				if (backgroundOpaque(source, v, X) == false)
+					continue;
+
+				// Pixel X is output on dot X + 1
+				const size_t dot = line * 341 + X + 1;
+
+				if (line == scanlines && X + 1 <= cycles)
+					PPUSTATUS.sprite_0_hit = 1;
+				else
+					sprite_0_dot = dot;
+
+				return;
 			}
 		}
+
+		incrementY(v);
+		copyX(v);
+	}
+}
+
+////////////////////
+// Scrolling
+////////////////////
+
+void PPU::incrementY(LoopyAddress& v) const
+{
+	if (v.fine_y < 7)
+	{
+		v.fine_y++;
+		return;
+	}
+
+	v.fine_y = 0;
+
+	// Row 29 is the last row of tiles, rows 30-31 hold attributes
+	if (v.coarse_y == 29)
+	{
+		v.coarse_y = 0;
+		v.nt_select ^= 2;
+	} else if (v.coarse_y == 31)
+	{
+		v.coarse_y = 0;
+	} else
+	{
+		v.coarse_y++;
+	}
+}
+
+void PPU::copyX(LoopyAddress& v) const
+{
+	v.coarse_x = temp_addr.coarse_x;
+	v.nt_select = (v.nt_select & 0b10) | (temp_addr.nt_select & 0b01);
+}
+
+void PPU::copyY(LoopyAddress& v) const
+{
+	v.coarse_y = temp_addr.coarse_y;
+	v.fine_y = temp_addr.fine_y;
+	v.nt_select = (v.nt_select & 0b01) | (temp_addr.nt_select & 0b10);
+}
+
+////////////////////
+// Palettes
+////////////////////
+
+void PPU::buildColorLUT()
+{
+	// Each emphasis bit darkens the two channels it does not name
+	constexpr double attenuation { 0.816328 };
+
+	for (size_t emphasis {}; emphasis < 8; ++emphasis)
+	{
+		const double R_scale = (emphasis & 0b110) ? attenuation : 1.0;
+		const double G_scale = (emphasis & 0b101) ? attenuation : 1.0;
+		const double B_scale = (emphasis & 0b011) ? attenuation : 1.0;
+
+		for (size_t color {}; color < palettes.size(); ++color)
+		{
+			const uint32_t argb = palettes[color];
+
+			const auto R = static_cast<uint32_t>(((argb >> 16) & 0xFF) * R_scale);
+			const auto G = static_cast<uint32_t>(((argb >> 8) & 0xFF) * G_scale);
+			const auto B = static_cast<uint32_t>((argb & 0xFF) * B_scale);
+
+			color_lut[(emphasis << 6) | color] =
+				0xFF000000 | (R << 16) | (G << 8) | B;
+		}
+	}
+}
+
+void PPU::resolvePalette(size_t index)
+{
+	// Greyscale keeps only the luminance row of the color index
+	const uint8_t mask = (PPUMASK.greyscale == 1) ? 0x30 : 0x3F;
+
+	active_palette[index] = vram_palettes[index] & mask;
+}
+
+void PPU::resolvePalettes()
+{
+	for (size_t i {}; i < active_palette.size(); ++i)
+		resolvePalette(i);
+}
+
+uint8_t PPU::readPalette(uint16_t addr) const
+{
+	return vram_palettes[addr & 0x1F];
+}
+
+void PPU::writePalette(uint16_t addr, uint8_t data)
+{
+	const size_t index = addr & 0x1F;
+
+	if (vram_palettes[index] == (data & 0x3F))
+		return;
+
+	palette_generation++;
+
+	// $3F10/$3F14/$3F18/$3F1C mirror $3F00/$3F04/$3F08/$3F0C
+	if ((index & 0x03) == 0)
+	{
+		vram_palettes[index & 0x0F] = data & 0x3F;
+		vram_palettes[index | 0x10] = data & 0x3F;
+
+		resolvePalette(index & 0x0F);
+		resolvePalette(index | 0x10);
+
+		logWrite(WriteTarget::Palette, index & 0x0F, data & 0x3F);
+		logWrite(WriteTarget::Palette, index | 0x10, data & 0x3F);
+	} else
+	{
+		vram_palettes[index] = data & 0x3F;
+		resolvePalette(index);
+
+		logWrite(WriteTarget::Palette, index, data & 0x3F);
 	}
+}
+
+////////////////////
+// Deferred rendering
+////////////////////
+
+void PPU::beginFrame()
+{
+	skipping = skip_frame;
+	deferring = deferred == true && skipping == false;
+	rows_ready = 0;
+
+	// A frame still on the workers is drained now, before inline rendering
+	// can touch buffer, and shown at this frame's vblank
+	if (deferring == false && band_renderer != nullptr)
+		collected = band_renderer->collect(buffer, emphasis);
+
+	if (deferring == false)
+		return;
+
+	// Collected frames overwrite buffer behind the row caches
+	for (RowCache& row : row_cache)
+		row.generation = 0;
+
+	BandRenderer::Frame& frame = band_renderer->recording();
+
+	frame.start.nametables = { nametable_0, nametable_1, nametable_2, nametable_3 };
+	frame.start.nametable_map = nametable_map;
+	frame.start.palettes = vram_palettes;
+	frame.start.OAM = OAM;
+
+	const RenderSource source = liveSource();
+
+	for (size_t page {}; page < source.patterns.size(); ++page)
+		std::copy_n(source.patterns[page], 0x0400, &frame.start.patterns[page * 0x0400]);
+
+	frame.writes.clear();
+}
+
+void PPU::logWrite(WriteTarget target, uint16_t addr, uint8_t data)
+{
+	// Writes during vblank land before the next frame's snapshot
+	if (deferring == false || scanlines >= SCREEN_H)
+		return;
+
+	band_renderer->recording().writes.push_back({
+		static_cast<uint32_t>(scanlines * 341 + cycles),
+		target,
+		addr,
+		data
+	});
 }
\ No newline at end of file
@@ -0,0 +1,669 @@
+#include "PostProcessor.hpp"
+
+#include "GUI.hpp"
+
+#include <algorithm>
+#include <chrono>
+#include <cstdlib>
+
+#ifdef __SSE2__
+#include <emmintrin.h>
+#endif
+
+PostProcessor::PostProcessor(const uint32_t *colors_ref)
+	: colors { colors_ref }
+	, source(PADDED_W * PADDED_H)
+{
+	worker = std::thread { &PostProcessor::work, this };
+}
+
+PostProcessor::~PostProcessor()
+{
+	{
+		std::lock_guard<std::mutex> lock { mutex };
+		stopping = true;
+	}
+
+	work_ready.notify_one();
+	worker.join();
+}
+
+size_t PostProcessor::scale(Filter filter)
+{
+	switch (filter)
+	{
+	case Filter::None:
+		return 1;
+	case Filter::Nearest:
+		return SCALE;
+	case Filter::Scale3x:
+		return 3;
+	case Filter::Scale2x:
+	case Filter::XBR:
+	case Filter::Scanlines:
+	case Filter::NTSC:
+		return 2;
+	}
+
+	return 1;
+}
+
+PostProcessor::Filter PostProcessor::next(Filter filter)
+{
+	switch (filter)
+	{
+	case Filter::None:
+		return Filter::Nearest;
+	case Filter::Nearest:
+		return Filter::Scale2x;
+	case Filter::Scale2x:
+		return Filter::Scale3x;
+	case Filter::Scale3x:
+		return Filter::XBR;
+	case Filter::XBR:
+		return Filter::Scanlines;
+	case Filter::Scanlines:
+		return Filter::NTSC;
+	case Filter::NTSC:
+		return Filter::None;
+	}
+
+	return Filter::None;
+}
+
+////////////////////
+// SDL thread
+////////////////////
+
+void PostProcessor::submit(const FrameExchange::Frame& frame, Filter filter)
+{
+	{
+		std::lock_guard<std::mutex> lock { mutex };
+
+		if (has_waiting == true)
+			filter_stats.dropped++;
+
+		waiting.frame = frame;
+		waiting.filter = filter;
+		has_waiting = true;
+	}
+
+	work_ready.notify_one();
+}
+
+const PostProcessor::Image *PostProcessor::acquire()
+{
+	std::lock_guard<std::mutex> lock { mutex };
+
+	if (has_ready == false)
+		return nullptr;
+
+	std::swap(ready, front);
+	has_ready = false;
+
+	return &front;
+}
+
+PostProcessor::FilterStats PostProcessor::stats()
+{
+	std::lock_guard<std::mutex> lock { mutex };
+
+	return filter_stats;
+}
+
+////////////////////
+// Worker
+////////////////////
+
+void PostProcessor::work()
+{
+	while (true)
+	{
+		{
+			std::unique_lock<std::mutex> lock { mutex };
+
+			work_ready.wait(lock, [this] { return stopping == true || has_waiting == true; });
+
+			if (stopping == true)
+				return;
+
+			std::swap(waiting, working);
+			has_waiting = false;
+		}
+
+		const auto start = std::chrono::steady_clock::now();
+
+		process(working, back);
+
+		const std::chrono::duration<double, std::micro> elapsed =
+			std::chrono::steady_clock::now() - start;
+
+		{
+			std::lock_guard<std::mutex> lock { mutex };
+
+			std::swap(back, ready);
+			has_ready = true;
+
+			filter_stats.frames++;
+			filter_stats.filter_us += elapsed.count();
+			filter_stats.max_us = std::max(filter_stats.max_us, elapsed.count());
+		}
+
+		if (on_ready != nullptr)
+			on_ready();
+	}
+}
+
+void PostProcessor::process(const Job& job, Image& image)
+{
+	const FrameExchange::Frame& frame = job.frame;
+
+	const size_t factor = scale(job.filter);
+
+	image.width = SCREEN_W * factor;
+	image.height = SCREEN_H * factor;
+	image.pixels.resize(image.width * image.height);
+	image.overlay = frame.overlay;
+
+	// Works from the color indexes instead of resolved colors
+	if (job.filter == Filter::NTSC)
+	{
+		composite(frame, image);
+		return;
+	}
+
+	// Resolve colors into the middle of the padded frame, then repeat the
+	// edge pixels outwards
+	for (size_t Y {}; Y < SCREEN_H; ++Y)
+	{
+		uint32_t *row = &source[(Y + BORDER) * PADDED_W];
+
+		GUI::convertRow(frame.pixels[Y], colors + ((frame.emphasis[Y] & 0x07) << 6), row + BORDER);
+
+		std::fill_n(row, BORDER, row[BORDER]);
+		std::fill_n(row + BORDER + SCREEN_W, BORDER, row[BORDER + SCREEN_W - 1]);
+	}
+
+	for (size_t Y {}; Y < BORDER; ++Y)
+	{
+		std::copy_n(&source[BORDER * PADDED_W], PADDED_W, &source[Y * PADDED_W]);
+		std::copy_n(
+			&source[(BORDER + SCREEN_H - 1) * PADDED_W],
+			PADDED_W,
+			&source[(BORDER + SCREEN_H + Y) * PADDED_W]
+		);
+	}
+
+	switch (job.filter)
+	{
+	case Filter::None:
+	case Filter::Nearest:
+		nearest(image, factor);
+		break;
+	case Filter::Scale2x:
+		scale2x(image);
+		break;
+	case Filter::Scale3x:
+		scale3x(image);
+		break;
+	case Filter::XBR:
+		xbr(image);
+		break;
+	case Filter::Scanlines:
+		scanlines(image);
+		break;
+	case Filter::NTSC:
+		break;
+	}
+}
+
+////////////////////
+// Filters
+////////////////////
+
+const uint32_t *PostProcessor::at(size_t X, size_t Y) const
+{
+	return &source[(Y + BORDER) * PADDED_W + X + BORDER];
+}
+
+void PostProcessor::nearest(Image& image, size_t factor) const
+{
+	for (size_t Y {}; Y < SCREEN_H; ++Y)
+	{
+		const uint32_t *in = at(0, Y);
+		uint32_t *out = &image.pixels[Y * factor * image.width];
+
+		for (size_t X {}; X < SCREEN_W; ++X)
+			std::fill_n(out + X * factor, factor, in[X]);
+
+		// The other rows of the block repeat the first
+		for (size_t copy { 1 }; copy < factor; ++copy)
+			std::copy_n(out, image.width, out + copy * image.width);
+	}
+}
+
+void PostProcessor::scale2x(Image& image) const
+{
+	for (size_t Y {}; Y < SCREEN_H; ++Y)
+	{
+		const uint32_t *E = at(0, Y);
+		const uint32_t *B = E - PADDED_W;
+		const uint32_t *H = E + PADDED_W;
+
+		uint32_t *top = &image.pixels[2 * Y * image.width];
+		uint32_t *bottom = top + image.width;
+
+#ifdef __SSE2__
+
+		static_assert(SCREEN_W % 4 == 0);
+
+		// Four source pixels per step; comparisons become lane masks and
+		// every output pixel is a masked select between E and a neighbour
+		for (size_t X {}; X < SCREEN_W; X += 4)
+		{
+			const auto load = [](const uint32_t *p) {
+				return _mm_loadu_si128(reinterpret_cast<const __m128i *>(p));
+			};
+
+			const auto select = [](__m128i mask, __m128i a, __m128i b) {
+				return _mm_or_si128(_mm_and_si128(mask, a), _mm_andnot_si128(mask, b));
+			};
+
+			const __m128i e = load(E + X);
+			const __m128i b = load(B + X);
+			const __m128i h = load(H + X);
+			const __m128i d = load(E + X - 1);
+			const __m128i f = load(E + X + 1);
+
+			const __m128i ones = _mm_set1_epi32(-1);
+
+			const __m128i b_f = _mm_cmpeq_epi32(b, f);
+			const __m128i d_h = _mm_cmpeq_epi32(d, h);
+			const __m128i d_b = _mm_cmpeq_epi32(d, b);
+			const __m128i h_f = _mm_cmpeq_epi32(h, f);
+
+			// Scale2x only acts where B != H and D != F
+			const __m128i active = _mm_andnot_si128(
+				_mm_or_si128(_mm_cmpeq_epi32(b, h), _mm_cmpeq_epi32(d, f)),
+				ones
+			);
+
+			const __m128i e0 = select(_mm_and_si128(active, d_b), d, e);
+			const __m128i e1 = select(_mm_and_si128(active, b_f), f, e);
+			const __m128i e2 = select(_mm_and_si128(active, d_h), d, e);
+			const __m128i e3 = select(_mm_and_si128(active, h_f), f, e);
+
+			auto store = [](uint32_t *p, __m128i v) {
+				_mm_storeu_si128(reinterpret_cast<__m128i *>(p), v);
+			};
+
+			store(top + 2 * X, _mm_unpacklo_epi32(e0, e1));
+			store(top + 2 * X + 4, _mm_unpackhi_epi32(e0, e1));
+			store(bottom + 2 * X, _mm_unpacklo_epi32(e2, e3));
+			store(bottom + 2 * X + 4, _mm_unpackhi_epi32(e2, e3));
+		}
+
+#else
+
+		for (size_t X {}; X < SCREEN_W; ++X)
+		{
+			const uint32_t b = B[X];
+			const uint32_t d = E[X - 1];
+			const uint32_t e = E[X];
+			const uint32_t f = E[X + 1];
+			const uint32_t h = H[X];
+
+			const bool active = b != h && d != f;
+
+			top[2 * X] = (active && d == b) ? d : e;
+			top[2 * X + 1] = (active && b == f) ? f : e;
+			bottom[2 * X] = (active && d == h) ? d : e;
+			bottom[2 * X + 1] = (active && h == f) ? f : e;
+		}
+
+#endif
+	}
+}
+
+void PostProcessor::scale3x(Image& image) const
+{
+	for (size_t Y {}; Y < SCREEN_H; ++Y)
+	{
+		const uint32_t *row = at(0, Y);
+
+		uint32_t *out[3] {
+			&image.pixels[3 * Y * image.width],
+			&image.pixels[(3 * Y + 1) * image.width],
+			&image.pixels[(3 * Y + 2) * image.width]
+		};
+
+#ifdef __SSE2__
+
+		// Four source pixels per step, as in scale2x; the nine outputs of
+		// each are masked selects, then three columns interleave per row
+		for (size_t X {}; X < SCREEN_W; X += 4)
+		{
+			const auto load = [&](ptrdiff_t offset) {
+				return _mm_loadu_si128(reinterpret_cast<const __m128i *>(row + X + offset));
+			};
+
+			const auto select = [](__m128i mask, __m128i a, __m128i b) {
+				return _mm_or_si128(_mm_and_si128(mask, a), _mm_andnot_si128(mask, b));
+			};
+
+			constexpr ptrdiff_t W = PADDED_W;
+
+			const __m128i a = load(-W - 1), b = load(-W), c = load(-W + 1);
+			const __m128i d = load(-1),     e = load(0),  f = load(1);
+			const __m128i g = load(W - 1),  h = load(W),  i = load(W + 1);
+
+			const __m128i ones = _mm_set1_epi32(-1);
+
+			// Scale3x only acts where B != H and D != F
+			const __m128i active = _mm_andnot_si128(
+				_mm_or_si128(_mm_cmpeq_epi32(b, h), _mm_cmpeq_epi32(d, f)),
+				ones
+			);
+
+			const __m128i d_b = _mm_and_si128(active, _mm_cmpeq_epi32(d, b));
+			const __m128i b_f = _mm_and_si128(active, _mm_cmpeq_epi32(b, f));
+			const __m128i d_h = _mm_and_si128(active, _mm_cmpeq_epi32(d, h));
+			const __m128i h_f = _mm_and_si128(active, _mm_cmpeq_epi32(h, f));
+
+			const __m128i e_a = _mm_cmpeq_epi32(e, a);
+			const __m128i e_c = _mm_cmpeq_epi32(e, c);
+			const __m128i e_g = _mm_cmpeq_epi32(e, g);
+			const __m128i e_i = _mm_cmpeq_epi32(e, i);
+
+			// X && E != Y
+			const auto unless = [](__m128i x, __m128i same) {
+				return _mm_andnot_si128(same, x);
+			};
+
+			const __m128i o00 = select(d_b, d, e);
+			const __m128i o01 = select(_mm_or_si128(unless(d_b, e_c), unless(b_f, e_a)), b, e);
+			const __m128i o02 = select(b_f, f, e);
+			const __m128i o10 = select(_mm_or_si128(unless(d_b, e_g), unless(d_h, e_a)), d, e);
+			const __m128i o12 = select(_mm_or_si128(unless(b_f, e_i), unless(h_f, e_c)), f, e);
+			const __m128i o20 = select(d_h, d, e);
+			const __m128i o21 = select(_mm_or_si128(unless(d_h, e_i), unless(h_f, e_g)), h, e);
+			const __m128i o22 = select(h_f, f, e);
+
+			// x0 y0 z0 x1 | y1 z1 x2 y2 | z2 x3 y3 z3
+			const auto store = [](uint32_t *p, __m128i x, __m128i y, __m128i z) {
+				const __m128 xy_lo = _mm_castsi128_ps(_mm_unpacklo_epi32(x, y));
+				const __m128 xy_hi = _mm_castsi128_ps(_mm_unpackhi_epi32(x, y));
+				const __m128 yz_lo = _mm_castsi128_ps(_mm_unpacklo_epi32(y, z));
+				const __m128 yz_hi = _mm_castsi128_ps(_mm_unpackhi_epi32(y, z));
+				const __m128 zx_lo = _mm_castsi128_ps(_mm_unpacklo_epi32(z, x));
+				const __m128 zx_hi = _mm_castsi128_ps(_mm_unpackhi_epi32(z, x));
+
+				float *q = reinterpret_cast<float *>(p);
+
+				_mm_storeu_ps(q, _mm_shuffle_ps(xy_lo, zx_lo, _MM_SHUFFLE(3, 0, 1, 0)));
+				_mm_storeu_ps(q + 4, _mm_shuffle_ps(yz_lo, xy_hi, _MM_SHUFFLE(1, 0, 3, 2)));
+				_mm_storeu_ps(q + 8, _mm_shuffle_ps(zx_hi, yz_hi, _MM_SHUFFLE(3, 2, 3, 0)));
+			};
+
+			store(out[0] + 3 * X, o00, o01, o02);
+			store(out[1] + 3 * X, o10, e, o12);
+			store(out[2] + 3 * X, o20, o21, o22);
+		}
+
+#else
+
+		for (size_t X {}; X < SCREEN_W; ++X)
+		{
+			const uint32_t *p = row + X;
+
+			const uint32_t A = p[-PADDED_W - 1], B = p[-PADDED_W], C = p[-PADDED_W + 1];
+			const uint32_t D = p[-1],            E = p[0],         F = p[1];
+			const uint32_t G = p[PADDED_W - 1],  H = p[PADDED_W],  I = p[PADDED_W + 1];
+
+			uint32_t *o0 = out[0] + 3 * X;
+			uint32_t *o1 = out[1] + 3 * X;
+			uint32_t *o2 = out[2] + 3 * X;
+
+			if (B == H || D == F)
+			{
+				std::fill_n(o0, 3, E);
+				std::fill_n(o1, 3, E);
+				std::fill_n(o2, 3, E);
+				continue;
+			}
+
+			o0[0] = (D == B) ? D : E;
+			o0[1] = (D == B && E != C) || (B == F && E != A) ? B : E;
+			o0[2] = (B == F) ? F : E;
+			o1[0] = (D == B && E != G) || (D == H && E != A) ? D : E;
+			o1[1] = E;
+			o1[2] = (B == F && E != I) || (H == F && E != C) ? F : E;
+			o2[0] = (D == H) ? D : E;
+			o2[1] = (D == H && E != I) || (H == F && E != G) ? H : E;
+			o2[2] = (H == F) ? F : E;
+		}
+
+#endif
+	}
+}
+
+void PostProcessor::xbr(Image& image)
+{
+	// Every pixel takes part in dozens of comparisons, so it is converted
+	// to YUV once instead of per comparison
+	for (std::vector<int32_t>& plane : yuv)
+		plane.resize(source.size());
+
+	for (size_t i {}; i < source.size(); ++i)
+	{
+		const int32_t R = (source[i] >> 16) & 0xFF;
+		const int32_t G = (source[i] >> 8) & 0xFF;
+		const int32_t B = source[i] & 0xFF;
+
+		yuv[0][i] = 77 * R + 150 * G + 29 * B;
+		yuv[1][i] = -43 * R - 85 * G + 128 * B;
+		yuv[2][i] = 128 * R - 107 * G - 21 * B;
+	}
+
+	for (size_t Y {}; Y < SCREEN_H; ++Y)
+	{
+		const size_t row = (Y + BORDER) * PADDED_W + BORDER;
+
+		uint32_t *top = &image.pixels[2 * Y * image.width];
+		uint32_t *bottom = top + image.width;
+
+#ifdef __SSE2__
+
+		static_assert(SCREEN_W % 4 == 0);
+
+		// Four source pixels per step. A mirrored corner only changes the
+		// offsets of its neighbours, so the lanes stay adjacent pixels
+		for (size_t X {}; X < SCREEN_W; X += 4)
+		{
+			const size_t base = row + X;
+
+			const auto load = [&](const auto *plane, ptrdiff_t offset) {
+				return _mm_loadu_si128(reinterpret_cast<const __m128i *>(plane + base + offset));
+			};
+
+			// |x| and constant products without SSSE3 or SSE4.1
+			const auto absolute = [](__m128i x) {
+				const __m128i sign = _mm_srai_epi32(x, 31);
+				return _mm_sub_epi32(_mm_xor_si128(x, sign), sign);
+			};
+
+			const auto distance = [&](ptrdiff_t a, ptrdiff_t b) {
+				const auto part = [&](size_t plane) {
+					return absolute(_mm_srai_epi32(
+						_mm_sub_epi32(load(yuv[plane].data(), a), load(yuv[plane].data(), b)),
+						8
+					));
+				};
+
+				const __m128i Y = part(0), U = part(1), V = part(2);
+
+				// 48 Y + 7 U + 6 V
+				return _mm_add_epi32(
+					_mm_add_epi32(_mm_slli_epi32(Y, 5), _mm_slli_epi32(Y, 4)),
+					_mm_add_epi32(
+						_mm_sub_epi32(_mm_slli_epi32(U, 3), U),
+						_mm_add_epi32(_mm_slli_epi32(V, 2), _mm_slli_epi32(V, 1))
+					)
+				);
+			};
+
+			const auto select = [](__m128i mask, __m128i a, __m128i b) {
+				return _mm_or_si128(_mm_and_si128(mask, a), _mm_andnot_si128(mask, b));
+			};
+
+			const __m128i e = load(source.data(), 0);
+			const __m128i half_e = _mm_srli_epi32(_mm_and_si128(e, _mm_set1_epi32(0xFEFEFE)), 1);
+
+			__m128i corners[4];
+
+			for (size_t corner {}; corner < 4; ++corner)
+			{
+				const ptrdiff_t sx = (corner & 1) ? 1 : -1;
+				const ptrdiff_t sy = (corner & 2) ? 1 : -1;
+
+				const auto n = [&](ptrdiff_t dx, ptrdiff_t dy) {
+					return sy * dy * static_cast<ptrdiff_t>(PADDED_W) + sx * dx;
+				};
+
+				const ptrdiff_t E = 0;
+				const ptrdiff_t B = n(0, -1), C = n(1, -1);
+				const ptrdiff_t D = n(-1, 0), F = n(1, 0), F4 = n(2, 0);
+				const ptrdiff_t G = n(-1, 1), H = n(0, 1), I = n(1, 1), I4 = n(2, 1);
+				const ptrdiff_t H5 = n(0, 2), I5 = n(1, 2);
+
+				const __m128i across = _mm_add_epi32(
+					_mm_add_epi32(_mm_add_epi32(distance(E, C), distance(E, G)), _mm_add_epi32(distance(I, F4), distance(I, H5))),
+					_mm_slli_epi32(distance(H, F), 2)
+				);
+				const __m128i along = _mm_add_epi32(
+					_mm_add_epi32(_mm_add_epi32(distance(H, D), distance(H, I5)), _mm_add_epi32(distance(F, I4), distance(F, B))),
+					_mm_slli_epi32(distance(E, I), 2)
+				);
+
+				const __m128i towards_f = _mm_andnot_si128(
+					_mm_cmpgt_epi32(distance(E, F), distance(E, H)),
+					_mm_set1_epi32(-1)
+				);
+				const __m128i other = select(towards_f, load(source.data(), F), load(source.data(), H));
+
+				const __m128i blended = _mm_or_si128(
+					_mm_set1_epi32(static_cast<int>(0xFF000000)),
+					_mm_add_epi32(half_e, _mm_srli_epi32(_mm_and_si128(other, _mm_set1_epi32(0xFEFEFE)), 1))
+				);
+
+				corners[corner] = select(_mm_cmplt_epi32(across, along), blended, e);
+			}
+
+			const auto store = [](uint32_t *p, __m128i v) {
+				_mm_storeu_si128(reinterpret_cast<__m128i *>(p), v);
+			};
+
+			store(top + 2 * X, _mm_unpacklo_epi32(corners[0], corners[1]));
+			store(top + 2 * X + 4, _mm_unpackhi_epi32(corners[0], corners[1]));
+			store(bottom + 2 * X, _mm_unpacklo_epi32(corners[2], corners[3]));
+			store(bottom + 2 * X + 4, _mm_unpackhi_epi32(corners[2], corners[3]));
+		}
+
+#else
+
+		for (size_t X {}; X < SCREEN_W; ++X)
+		{
+			const size_t E = row + X;
+
+			uint32_t corners[4] { source[E], source[E], source[E], source[E] };
+
+			// Each corner is the bottom-right rule seen through a mirror:
+			// 0 top-left, 1 top-right, 2 bottom-left, 3 bottom-right
+			for (size_t corner {}; corner < 4; ++corner)
+			{
+				const ptrdiff_t sx = (corner & 1) ? 1 : -1;
+				const ptrdiff_t sy = (corner & 2) ? 1 : -1;
+
+				const auto n = [&](ptrdiff_t dx, ptrdiff_t dy) {
+					return E + sy * dy * static_cast<ptrdiff_t>(PADDED_W) + sx * dx;
+				};
+
+				const size_t B = n(0, -1), C = n(1, -1);
+				const size_t D = n(-1, 0), F = n(1, 0), F4 = n(2, 0);
+				const size_t G = n(-1, 1), H = n(0, 1), I = n(1, 1), I4 = n(2, 1);
+				const size_t H5 = n(0, 2), I5 = n(1, 2);
+
+				// Weighted edge strength across and along the corner's diagonal
+				const uint32_t across = distance(E, C) + distance(E, G)
+					+ distance(I, F4) + distance(I, H5) + 4 * distance(H, F);
+				const uint32_t along = distance(H, D) + distance(H, I5)
+					+ distance(F, I4) + distance(F, B) + 4 * distance(E, I);
+
+				if (across < along)
+					corners[corner] = blend(source[E], source[distance(E, F) <= distance(E, H) ? F : H]);
+			}
+
+			top[2 * X] = corners[0];
+			top[2 * X + 1] = corners[1];
+			bottom[2 * X] = corners[2];
+			bottom[2 * X + 1] = corners[3];
+		}
+
+#endif
+	}
+}
+
+void PostProcessor::scanlines(Image& image) const
+{
+	for (size_t Y {}; Y < SCREEN_H; ++Y)
+	{
+		const uint32_t *in = at(0, Y);
+
+		uint32_t *lit = &image.pixels[2 * Y * image.width];
+		uint32_t *dim = lit + image.width;
+
+		for (size_t X {}; X < SCREEN_W; ++X)
+		{
+			lit[2 * X] = in[X];
+			lit[2 * X + 1] = in[X];
+		}
+
+		// 75% brightness, written to vectorize
+		for (size_t X {}; X < image.width; ++X)
+			dim[X] = lit[X] - ((lit[X] >> 2) & 0x003F3F3F);
+	}
+}
+
+uint32_t PostProcessor::distance(size_t a, size_t b) const
+{
+	// The planes hold 256 times each component, as the differences did
+	const int32_t Y = (yuv[0][a] - yuv[0][b]) >> 8;
+	const int32_t U = (yuv[1][a] - yuv[1][b]) >> 8;
+	const int32_t V = (yuv[2][a] - yuv[2][b]) >> 8;
+
+	// YUV difference, luma weighted heaviest as in xBR
+	return 48 * std::abs(Y) + 7 * std::abs(U) + 6 * std::abs(V);
+}
+
+uint32_t PostProcessor::blend(uint32_t a, uint32_t b)
+{
+	return 0xFF000000 | (((a & 0xFEFEFE) >> 1) + ((b & 0xFEFEFE) >> 1));
+}
+
+void PostProcessor::composite(const FrameExchange::Frame& frame, Image& image)
+{
+	if (ntsc == nullptr)
+		ntsc = std::make_unique<NTSCFilter>();
+
+	static_assert(NTSCFilter::OUT_W == 2 * SCREEN_W);
+
+	// Decode into every other row, then repeat each line below itself
+	ntsc->apply(frame.pixels, frame.emphasis.data(), frame.number, image.pixels.data(), 2 * image.width);
+
+	for (size_t Y {}; Y < SCREEN_H; ++Y)
+	{
+		uint32_t *line = &image.pixels[2 * Y * image.width];
+
+		std::copy_n(line, image.width, line + image.width);
+	}
+}
\ No newline at end of file
@@ -0,0 +1,108 @@
+#include "ScanoutClock.hpp"
+
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+
+bool ScanoutClock::calibrate(const std::vector<Clock::time_point>& presents, std::chrono::nanoseconds nominal)
+{
+	if (presents.size() < WARMUP + 16)
+		return false;
+
+	const Clock::time_point first = presents[WARMUP];
+	const size_t count = presents.size() - WARMUP;
+
+	// Without a display mode the typical gap between presents stands in
+	if (nominal.count() <= 0)
+	{
+		std::vector<Clock::duration> gaps;
+
+		for (size_t i { WARMUP + 1 }; i < presents.size(); ++i)
+			gaps.push_back(presents[i] - presents[i - 1]);
+
+		std::nth_element(gaps.begin(), gaps.begin() + gaps.size() / 2, gaps.end());
+		nominal = std::chrono::duration_cast<std::chrono::nanoseconds>(gaps[gaps.size() / 2]);
+	}
+
+	if (nominal.count() <= 0)
+		return false;
+
+	// Least squares of return time against refresh number. Refreshes are
+	// counted from the nominal period, so a present that missed a flip
+	// still lands on the right one
+	double sum_k {}, sum_t {}, sum_kk {}, sum_kt {};
+
+	for (size_t i {}; i < count; ++i)
+	{
+		const double t = std::chrono::duration<double, std::nano>(presents[WARMUP + i] - first).count();
+		const double k = std::round(t / nominal.count());
+
+		sum_k += k;
+		sum_t += t;
+		sum_kk += k * k;
+		sum_kt += k * t;
+	}
+
+	const double spread = count * sum_kk - sum_k * sum_k;
+
+	if (spread <= 0)
+		return false;
+
+	const double slope = (count * sum_kt - sum_k * sum_t) / spread;
+	const double intercept = (sum_t - slope * sum_k) / count;
+
+	if (std::abs(slope - nominal.count()) > MAX_DEVIATION * nominal.count())
+		return false;
+
+	std::lock_guard<std::mutex> lock { mutex };
+
+	refresh = std::chrono::nanoseconds { std::llround(slope) };
+	vsync = first + std::chrono::nanoseconds { std::llround(intercept) };
+	fitted = true;
+
+	return true;
+}
+
+void ScanoutClock::setWindow(double top, double height, std::chrono::nanoseconds nominal)
+{
+	std::lock_guard<std::mutex> lock { mutex };
+
+	window_top = top;
+	window_height = height;
+
+	if (fitted == true && nominal.count() > 0
+	    && std::abs(static_cast<double>((refresh - nominal).count())) > MAX_DEVIATION * nominal.count())
+		fitted = false;
+}
+
+bool ScanoutClock::calibrated() const
+{
+	std::lock_guard<std::mutex> lock { mutex };
+
+	return fitted;
+}
+
+std::chrono::nanoseconds ScanoutClock::period() const
+{
+	std::lock_guard<std::mutex> lock { mutex };
+
+	return refresh;
+}
+
+ScanoutClock::Clock::time_point ScanoutClock::rowTime(double fraction, Clock::time_point after) const
+{
+	std::lock_guard<std::mutex> lock { mutex };
+
+	// Line 0 follows the blank that starts at each flip
+	const double blank = VBLANK_SHARE * refresh.count();
+	const double line = std::clamp(window_top + window_height * fraction, 0.0, 1.0);
+	const Clock::time_point first = vsync + std::chrono::nanoseconds { std::llround(blank + line * (refresh.count() - blank)) };
+
+	// Whole refreshes from the fitted one to the first reaching the line
+	// at or after `after`, rounded up
+	const int64_t since = std::chrono::duration_cast<std::chrono::nanoseconds>(after - first).count();
+	const int64_t period = refresh.count();
+	const int64_t refreshes = (since > 0) ? (since + period - 1) / period : -(-since / period);
+
+	return first + refreshes * refresh;
+}
\ No newline at end of file
@@ -0,0 +1,89 @@
+#include "SpeedGovernor.hpp"
+
+#include <cstdio>
+
+SpeedGovernor::SpeedGovernor(FramePacer& pacer_ref, FrameSkip& frame_skip_ref)
+	: frame_skip { &frame_skip_ref }
+	, base_mode { frame_skip_ref.getMode() }
+	, base_frames { frame_skip_ref.getFrames() }
+	, pacer { &pacer_ref }
+{
+}
+
+void SpeedGovernor::cycle()
+{
+	if (mode == Mode::Normal)
+	{
+		mode = Mode::FastForward;
+		multiplier = 2;
+	} else if (mode == Mode::FastForward && multiplier < 8)
+	{
+		multiplier *= 2;
+	} else if (mode == Mode::FastForward)
+	{
+		mode = Mode::Turbo;
+		multiplier = 0;
+	} else
+	{
+		mode = Mode::Normal;
+		multiplier = 1;
+	}
+
+	// Keep presentation near the display rate however fast frames are made
+	switch (mode)
+	{
+	case Mode::Normal:
+		frame_skip->setMode(base_mode, base_frames);
+		break;
+	case Mode::FastForward:
+		frame_skip->setMode(FrameSkip::Mode::Fixed, multiplier - 1);
+		break;
+	case Mode::Turbo:
+		frame_skip->setMode(FrameSkip::Mode::Throttled);
+		break;
+	}
+
+	pacer->reset();
+	window_start = {};
+}
+
+void SpeedGovernor::frame()
+{
+	const auto now = std::chrono::steady_clock::now();
+
+	if (window_start == std::chrono::steady_clock::time_point {})
+	{
+		window_start = now;
+		window_frames = 0;
+	}
+
+	window_frames++;
+
+	if (now - window_start >= WINDOW)
+	{
+		const std::chrono::duration<double> elapsed = now - window_start;
+		const std::chrono::duration<double> emulated = window_frames * pacer->period();
+
+		speed = emulated / elapsed;
+		window_start = now;
+		window_frames = 0;
+	}
+
+	if (mode != Mode::Turbo)
+		pacer->wait(multiplier);
+}
+
+std::string SpeedGovernor::label() const
+{
+	if (mode == Mode::Normal)
+		return "";
+
+	char text[32];
+
+	if (mode == Mode::Turbo)
+		std::snprintf(text, sizeof(text), "TURBO %.1fX", speed);
+	else
+		std::snprintf(text, sizeof(text), "%zuX %.1fX", multiplier, speed);
+
+	return text;
+}
\ No newline at end of file
@@ -1,3 +1,4 @@
+#include "APU.hpp"
 #include "Bus.hpp"
 #include "Cartridge.hpp"
 #include "CPU.hpp"
@@ -10,13 +11,80 @@
 
 // #define CPU_ONLY
 // #define LOGGING
+// #define DEFERRED_RENDERING
+// #define FRAME_SKIP 2        // draw 1 frame in every FRAME_SKIP + 1
+// #define FRAME_SKIP_ADAPTIVE // draw only while keeping up with real time
+// #define PAL_TIMING          // pace frames at 50.0070 Hz
+// #define VSYNC               // wait for the display when presenting
+// #define BEAM_RACING 4       // present each frame in this many slices, ahead of the raster
+// #define HEADLESS 3600       // run this many frames as fast as possible, no window
+// #define CAPTURE_PATH "capture.y4m" // file, numbered PNG prefix or "|command"
+// #define CAPTURE_FORMAT Y4M  // Y4M, Raw (RGB24) or PNG
+// #define HASH_LOG "frames.hash" // log a hash of every frame for hash_compare
+// #define LATENCY_PROBE       // time key presses to the first frame they change
+// #define MUTE                // no audio device; frames are paced by the timer
+// #define STEREO              // pan the pulses apart and the noise slightly right
+// #define AUDIO_PATH "audio.wav" // headless: dump the sound, file or "|command"
+// #define AUDIO_FORMAT WAV    // WAV (float) or Raw (f32le)
+// #define AUDIO_RATE 44100    // headless: resample the dump to this rate
+
+// The APU runs at NTSC rates, so its sound cannot pace PAL frames
+#if defined(PAL_TIMING) && !defined(MUTE)
+#define MUTE
+#endif
+
+#ifndef CAPTURE_FORMAT
+#define CAPTURE_FORMAT Y4M
+#endif
+
+#ifndef AUDIO_FORMAT
+#define AUDIO_FORMAT WAV
+#endif
 
 #ifdef LOGGING
 #include "Logger.hpp"
 #endif
 
-#ifndef CPU_ONLY
+#ifdef HEADLESS
+#include "FramePacer.hpp"
+#endif
+
+#ifdef CAPTURE_PATH
+#include "Capture.hpp"
+#endif
+
+#ifdef HASH_LOG
+#include "FrameHash.hpp"
+#endif
+
+#ifdef AUDIO_PATH
+#include "AudioChain.hpp"
+#include "AudioWriter.hpp"
+
+#include <vector>
+#endif
+
+#ifdef LATENCY_PROBE
+#include "LatencyProbe.hpp"
+#endif
+
+#if !defined(CPU_ONLY) && !defined(HEADLESS)
+#include "AudioChain.hpp"
+#include "AudioOutput.hpp"
+#include "BeamRacer.hpp"
+#include "ScanoutClock.hpp"
+#include "FrameExchange.hpp"
+#include "FramePacer.hpp"
+#include "FrameSkip.hpp"
 #include "GUI.hpp"
+#include "PostProcessor.hpp"
+#include "SpeedGovernor.hpp"
+#include "SPSCQueue.hpp"
+
+#include <algorithm>
+#include <atomic>
+#include <thread>
+#include <vector>
 #endif
 
 int main(int argc, char **argv)
@@ -60,6 +128,18 @@ int main(int argc, char **argv)
 	PPU ppu { bus };
 	bus.connectPPU(ppu);
 
+	// APU
+	APU apu { bus };
+	bus.connectAPU(apu);
+
+#ifdef STEREO
+	apu.setPanning({ -0.5f, 0.5f, 0.0f, 0.25f, 0.0f });
+#endif
+
+#ifdef DEFERRED_RENDERING
+	ppu.setDeferredRendering(true);
+#endif
+
 	////////////////////
 	// Logging
 	////////////////////
@@ -104,33 +184,467 @@ int main(int argc, char **argv)
 	}
 #endif // CPU_ONLY
 
-#ifndef CPU_ONLY
+#if defined(HASH_LOG) && !defined(CPU_ONLY)
+	FrameHash frame_hash { HASH_LOG };
+#endif
 
-	GUI gui {};
+#ifdef HEADLESS
+
+#ifdef CAPTURE_PATH
+#ifdef PAL_TIMING
+	Capture capture { CAPTURE_PATH, Capture::Format::CAPTURE_FORMAT, ppu.color_lut.data(), PAL_FRAME, Capture::Overflow::Wait };
+#else
+	Capture capture { CAPTURE_PATH, Capture::Format::CAPTURE_FORMAT, ppu.color_lut.data(), NTSC_FRAME, Capture::Overflow::Wait };
+#endif
+#endif
 
-	bool running = true;
-	while (running)
+#ifdef AUDIO_PATH
+#ifdef AUDIO_RATE
+	AudioChain audio_chain { SAMPLE_RATE, AUDIO_RATE, apu.channels() };
+	AudioWriter audio_writer { AUDIO_PATH, AudioWriter::Format::AUDIO_FORMAT, AUDIO_RATE, apu.channels() };
+#else
+	AudioChain audio_chain { SAMPLE_RATE, SAMPLE_RATE, apu.channels() };
+	AudioWriter audio_writer { AUDIO_PATH, AudioWriter::Format::AUDIO_FORMAT, SAMPLE_RATE, apu.channels() };
+#endif
+
+	std::vector<float> left;
+	std::vector<float> right;
+#endif
+
+	// Nothing paces or presents; every completed frame goes to the capture,
+	// which holds the run up rather than drop one
+	for (size_t frame {}; frame < HEADLESS;)
 	{
-// Logging
 #ifdef LOGGING
 		logger.logLine();
 #endif
 
 		cpu.step();
 
-		if (ppu.update_screen == true)
+		if (ppu.update_screen == false)
+			continue;
+
+		ppu.update_screen = false;
+		frame++;
+
+#ifdef HASH_LOG
+		frame_hash.record(ppu.buffer, ppu.emphasis);
+#endif
+
+#ifdef CAPTURE_PATH
+		capture.submit(ppu.buffer, ppu.emphasis);
+#endif
+
+#ifdef AUDIO_PATH
+		apu.endFrame();
+		left.resize(apu.samplesAvailable());
+		right.resize(left.size());
+		apu.readSamples(left.data(), right.data(), left.size());
+
+		const std::vector<float>& sound = audio_chain.process(left.data(), right.data(), left.size());
+		audio_writer.submit(sound.data(), sound.size());
+#endif
+	}
+
+#ifdef CAPTURE_PATH
+	capture.finish();
+
+	const Capture::CaptureStats captured = capture.stats();
+
+	std::cout << "Captured " << captured.frames << " frames, " << captured.dropped << " dropped, "
+	          << captured.stalls << " stalls, " << captured.bytes << " bytes, "
+	          << (captured.frames > 0 ? captured.encode_us / captured.frames : 0) << " us encode\n";
+
+	// A recording with gaps no longer follows the emulated timeline
+	if (captured.dropped > 0)
+	{
+		std::cerr << "Capture dropped " << captured.dropped << " frames\n";
+		return 1;
+	}
+#endif
+
+#ifdef AUDIO_PATH
+	audio_writer.finish();
+
+	const AudioWriter::WriterStats dumped = audio_writer.stats();
+
+	std::cout << "Wrote " << dumped.samples / apu.channels() << " audio sample frames, "
+	          << dumped.bytes << " bytes, " << dumped.stalls << " stalls\n";
+
+	if (dumped.dropped > 0)
+		std::cerr << dumped.dropped / apu.channels() << " audio sample frames past the WAVE size limit were dropped\n";
+#endif
+
+#endif // HEADLESS
+
+#if !defined(CPU_ONLY) && !defined(HEADLESS)
+
+	// With emulation on its own thread the display cannot pace it, so
+	// vsync only smooths presentation; slices must never wait for it, and
+	// race a raster modelled from the display's measured refresh instead
+#if defined(BEAM_RACING)
+	ScanoutClock scanout;
+	GUI gui { false, &scanout };
+#elif defined(VSYNC)
+	GUI gui { true };
+#else
+	GUI gui {};
+#endif
+
+#ifdef PAL_TIMING
+	FramePacer pacer { FramePacer::Region::PAL };
+#else
+	FramePacer pacer { FramePacer::Region::NTSC };
+#endif
+
+#if defined(FRAME_SKIP_ADAPTIVE)
+	FrameSkip frame_skip { FrameSkip::Mode::Adaptive, 0, pacer.period() };
+#elif defined(FRAME_SKIP)
+	FrameSkip frame_skip { FrameSkip::Mode::Fixed, FRAME_SKIP, pacer.period() };
+#else
+	FrameSkip frame_skip { FrameSkip::Mode::Off, 0, pacer.period() };
+#endif
+
+	// Tab cycles through 2x, 4x, 8x fast-forward, turbo and normal speed
+	SpeedGovernor speed { pacer, frame_skip };
+
+#ifdef BEAM_RACING
+	BeamRacer beam_racer { pacer, scanout, BEAM_RACING };
+#endif
+
+#ifdef LATENCY_PROBE
+	LatencyProbe latency_probe;
+#endif
+
+#ifndef MUTE
+	// The device's clock paces emulation: each frame waits until the
+	// queued sound drains to the target, and rate control keeps what is
+	// made matched to what is played
+	AudioOutput audio_output { SAMPLE_RATE, apu.channels(), NTSC_FRAME };
+	AudioChain audio_chain { SAMPLE_RATE, audio_output.rate(), apu.channels() };
+
+	if (audio_output.opened() == true)
+	{
+		pacer.sync = FramePacer::Sync::Audio;
+		pacer.audio_queued = [&] { return audio_output.queued(); };
+		pacer.audio_target = audio_output.target();
+	}
+#endif
+
+	////////////////////
+	// Threads
+	////////////////////
+
+	// The emulation thread owns the CPU, PPU and pacing; this thread owns
+	// SDL. Frames go one way through the exchange, input the other way
+	// through the queue, and neither thread ever waits on the other.
+	FrameExchange frames;
+	SPSCQueue<KeyEvent, 256> input;
+
+	const Uint32 FRAME_READY = SDL_RegisterEvents(1);
+
+	std::atomic<bool> running { true };
+
+	size_t samples_synthesized {};
+
+	std::thread emulation { [&] {
+		size_t frame_number {};
+
+		std::vector<float> left;
+		std::vector<float> right;
+
+		// Copies the first rows of the frame being drawn to the other thread
+		const auto publish = [&](size_t rows, const std::string& overlay) {
+			FrameExchange::Frame& frame = frames.back();
+
+			std::copy_n(&ppu.buffer[0][0], rows * SCREEN_W, &frame.pixels[0][0]);
+			frame.emphasis = ppu.emphasis;
+			frame.overlay = overlay;
+			frame.number = frame_number;
+			frame.rows = rows;
+
+			frames.publish();
+
+			SDL_Event ready {};
+			ready.type = FRAME_READY;
+			SDL_PushEvent(&ready);
+		};
+
+		while (running.load(std::memory_order_relaxed) == true)
 		{
-			ppu.updateBuffer();
-			gui.renderFrame(ppu.buffer);
+// Logging
+#ifdef LOGGING
+			logger.logLine();
+#endif
+
+			cpu.step();
+
+#ifdef BEAM_RACING
+			// Slices only race the beam at normal speed
+			if (speed.mode == SpeedGovernor::Mode::Normal
+			    && beam_racer.sliceReady(ppu.rows_ready) == true)
+				publish(beam_racer.rows, "");
+#endif
+
+			if (ppu.update_screen == false)
+				continue;
 
 			ppu.update_screen = false;
+
+#ifdef HASH_LOG
+			// Skipped frames leave the last drawn one in buffer
+			frame_hash.record(ppu.buffer, ppu.emphasis);
+#endif
+
+			// Input is sampled once per frame
+			KeyEvent key {};
+
+			while (input.pop(key) == true)
+			{
+				if (key.pressed == true && key.key == SDLK_TAB)
+					speed.cycle();
+
+				// Q cycles the resampler's kernel between 8, 16 and 32 taps
+				if (key.pressed == true && key.key == SDLK_q)
+					apu.setQuality(BlipBuffer::next(apu.getQuality()));
+			}
+
+			// Sound is synthesized as the CPU runs and resampled once per frame
+			apu.endFrame();
+			left.resize(apu.samplesAvailable());
+			right.resize(left.size());
+			samples_synthesized += apu.readSamples(left.data(), right.data(), left.size());
+
+#ifndef MUTE
+			// Fast-forwarded sound would only overrun the queue
+			if (speed.mode == SpeedGovernor::Mode::Normal)
+			{
+				const std::vector<float>& sound = audio_chain.process(left.data(), right.data(), left.size());
+
+				audio_output.push(sound.data(), sound.size());
+				apu.setRateRatio(audio_output.ratio());
+			}
+#endif
+
+			bus.controllers[0].sample();
+			bus.controllers[1].sample();
+
+#ifdef LATENCY_PROBE
+			latency_probe.frame(ppu.buffer, ppu.emphasis);
+#endif
+
+			// Scanlines are drawn as the PPU reaches them, so only publish
+			// frames that differ from the one already on screen, or drawn
+			// frames while the speed overlay needs refreshing
+			const std::string overlay = speed.label();
+
+#ifdef BEAM_RACING
+			const bool raced = beam_racer.rows == SCREEN_H;
+#else
+			const bool raced = false;
+#endif
+
+			if (raced == false
+			    && (ppu.frame_dirty == true || (ppu.skip_frame == false && overlay.empty() == false)))
+				publish(SCREEN_H, overlay);
+
+			ppu.skip_frame = frame_skip.next();
+
+			speed.frame();
+			frame_number++;
+
+#ifdef BEAM_RACING
+			beam_racer.beginFrame();
+#endif
+		}
+	} };
+
+	size_t shown_number { SIZE_MAX };
+	size_t shown_rows {};
+
+	// F cycles through the scaling filters and composite video decoding,
+	// run on their own workers
+	PostProcessor post_processor { ppu.color_lut.data() };
+	PostProcessor::Filter filter { PostProcessor::Filter::None };
+
+	post_processor.on_ready = [&] {
+		SDL_Event ready {};
+		ready.type = FRAME_READY;
+		SDL_PushEvent(&ready);
+	};
+
+	// Keyboard layout of controller 1
+	const auto buttons = [](SDL_Keycode key) -> uint8_t {
+		switch (key)
+		{
+		case SDLK_x:
+			return Controller::A;
+		case SDLK_z:
+			return Controller::B;
+		case SDLK_RSHIFT:
+			return Controller::Select;
+		case SDLK_RETURN:
+			return Controller::Start;
+		case SDLK_UP:
+			return Controller::Up;
+		case SDLK_DOWN:
+			return Controller::Down;
+		case SDLK_LEFT:
+			return Controller::Left;
+		case SDLK_RIGHT:
+			return Controller::Right;
+		default:
+			return 0;
 		}
+	};
 
-		while (SDL_PollEvent(&gui.event))
+	while (running.load(std::memory_order_relaxed) == true)
+	{
+		// Sleeps until input arrives or a frame is published
+		if (SDL_WaitEvent(&gui.event) == 0)
+			continue;
+
+		do
+		{
 			if (gui.event.type == SDL_QUIT)
 				running = false;
+
+			if ((gui.event.type == SDL_KEYDOWN || gui.event.type == SDL_KEYUP)
+			    && gui.event.key.repeat == 0)
+			{
+				const bool pressed = gui.event.type == SDL_KEYDOWN;
+
+				// Buttons go straight to the controller, which the
+				// emulation thread samples at the next frame
+				if (const uint8_t held = buttons(gui.event.key.keysym.sym))
+				{
+					bus.controllers[0].press(held, pressed);
+
+#ifdef LATENCY_PROBE
+					if (pressed == true)
+						latency_probe.press();
+#endif
+				} else
+				{
+					input.push({ gui.event.key.keysym.sym, pressed });
+				}
+			}
+
+			if (gui.event.type == SDL_KEYDOWN
+			    && gui.event.key.keysym.sym == SDLK_f
+			    && gui.event.key.repeat == 0)
+				filter = PostProcessor::next(filter);
+
+#ifdef BEAM_RACING
+			// Slices race the raster down the window's own rows
+			if (gui.event.type == SDL_WINDOWEVENT)
+				gui.trackWindow();
+#endif
+		} while (SDL_PollEvent(&gui.event));
+
+		// A frame published while the last one was presenting replaces it;
+		// slices of the frame on screen only upload their new rows
+		const FrameExchange::Frame *frame = frames.acquire();
+
+		// Filters take whole frames; beam-raced slices wait for the last
+		if (frame != nullptr && filter != PostProcessor::Filter::None)
+		{
+			if (frame->rows == SCREEN_H)
+				post_processor.submit(*frame, filter);
+		} else if (frame != nullptr)
+		{
+			const size_t first = (frame->number == shown_number) ? shown_rows : 0;
+
+			gui.overlay = frame->overlay;
+			gui.renderFrame(
+				frame->pixels,
+				frame->emphasis.data(),
+				ppu.color_lut.data(),
+				first,
+				frame->rows
+			);
+
+			shown_number = frame->number;
+			shown_rows = frame->rows;
+		}
+
+		if (const PostProcessor::Image *image = post_processor.acquire())
+		{
+			gui.overlay = image->overlay;
+			gui.renderImage(image->pixels.data(), image->width, image->height);
+
+			// The frame texture no longer holds what is on screen
+			shown_number = SIZE_MAX;
+		}
 	}
 
+	emulation.join();
+
+	const FramePacer::JitterStats jitter = pacer.jitter();
+
+	std::cout << "Paced " << jitter.frames << " frames, " << jitter.late << " late, jitter "
+	          << jitter.mean_us << " us mean, " << jitter.rms_us << " us rms, "
+	          << jitter.max_us << " us max\n";
+
+#ifdef BEAM_RACING
+	const BeamRacer::RaceStats& race = beam_racer.race_stats;
+
+	if (scanout.calibrated() == true)
+		std::cout << "Raced " << race.frames << " frames against a "
+		          << scanout.period().count() / 1000.0 << " us refresh, "
+		          << race.slices << " slices, " << race.late << " behind the raster\n";
+#endif
+
+#ifdef LATENCY_PROBE
+	const LatencyProbe::LatencyStats& latency = latency_probe.latency_stats;
+
+	if (latency.presses > 0)
+		std::cout << "Input latency over " << latency.presses << " presses: "
+		          << latency.frames / latency.presses << " frames, "
+		          << latency.ms / latency.presses << " ms mean, "
+		          << latency.max_ms << " ms max, "
+		          << latency.ignored << " presses changed nothing\n";
+#endif
+
+	std::cout << "Synthesized " << samples_synthesized << " audio samples at " << SAMPLE_RATE
+	          << " Hz, " << BlipBuffer::name(apu.getQuality()) << " quality\n";
+
+#ifndef MUTE
+	const AudioOutput::AudioStats played = audio_output.stats();
+
+	if (played.callbacks > 0)
+		std::cout << "Played " << played.callbacks << " device buffers, "
+		          << played.underruns << " underruns (" << played.starved << " samples), "
+		          << played.overruns << " overruns (" << played.dropped << " samples), queue "
+		          << played.fill_ms << " ms mean, " << played.max_fill_ms << " ms max, rate "
+		          << played.min_ratio << " to " << played.max_ratio << '\n';
+#endif
+
+	std::cout << "Published " << frames.published << " frames, "
+	          << frames.dropped << " replaced before presentation\n";
+
+	const PostProcessor::FilterStats filtered = post_processor.stats();
+
+	if (filtered.frames > 0)
+		std::cout << "Filtered " << filtered.frames << " frames, "
+		          << filtered.dropped << " dropped, "
+		          << filtered.filter_us / filtered.frames << " us mean, "
+		          << filtered.max_us << " us max\n";
+
+	const GUI::PresentStats& present = gui.present_stats;
+
+	if (present.frames > 0)
+		std::cout << "Presented " << present.frames << " frames ("
+		          << (gui.accelerated == true ? "accelerated" : "software") << "), "
+		          << present.convert_us / present.frames << " us convert, "
+		          << present.present_us / present.frames << " us present, "
+		          << present.max_us << " us max\n";
+
+#if defined(FRAME_SKIP) || defined(FRAME_SKIP_ADAPTIVE)
+	std::cout << "Frames: " << ppu.dirty_stats.frames
+	          << ", skipped: " << ppu.dirty_stats.frames_skipped << '\n';
+#endif
+
 #endif
 
 #ifdef LOGGING
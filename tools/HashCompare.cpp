@@ -0,0 +1,50 @@
+#include "FrameHash.hpp"
+
+#include <algorithm>
+#include <cstdio>
+#include <iostream>
+#include <string>
+
+// Reports the first frame where a run's hash log departs from a golden one.
+// Exits 0 when the logs match, 1 when they differ and 2 on bad input.
+int main(int argc, char **argv)
+{
+	if (argc != 3)
+	{
+		std::cerr << "Usage: <golden log> <run log>\n";
+		return 2;
+	}
+
+	const std::vector<uint64_t> golden = FrameHash::load(argv[1]);
+	const std::vector<uint64_t> run = FrameHash::load(argv[2]);
+
+	if (golden.empty() == true || run.empty() == true)
+	{
+		std::cerr << "Error reading frame hash log\n";
+		return 2;
+	}
+
+	const size_t common = std::min(golden.size(), run.size());
+	const auto [expected, actual] = std::mismatch(golden.begin(), golden.begin() + common, run.begin());
+
+	if (expected != golden.begin() + common)
+	{
+		char hashes[64];
+		std::snprintf(hashes, sizeof(hashes), "%016llx, got %016llx",
+			static_cast<unsigned long long>(*expected),
+			static_cast<unsigned long long>(*actual));
+
+		std::cout << "Frame " << (expected - golden.begin()) << " differs: expected " << hashes << '\n';
+		return 1;
+	}
+
+	if (golden.size() != run.size())
+	{
+		std::cout << "Frames match through " << common << ", but the golden run has "
+		          << golden.size() << " frames and this run " << run.size() << '\n';
+		return 1;
+	}
+
+	std::cout << "All " << common << " frames match\n";
+	return 0;
+}
\ No newline at end of file